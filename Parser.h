@@ -64,7 +64,18 @@
  *         one specified will be retain ("gustavo") in this case. But if you
  *         use the StringListOption you'll get both string entries contained
  *         within a list in the same order as they were typed.
- *          
+ *
+ *         The lists of numbers also take several values at once, separated
+ *         by commas: "--port 80,443 --port 8080" gives { 80, 443, 8080 }
+ *
+ *         And the lists with allowValueFiles() read them from a file, one
+ *         per line: "--hosts=@hosts.txt". The file is mapped, so a
+ *         StringViewListOption keeps views of its lines (no copies). A
+ *         value starting with '@' is then written twice: "--hosts=@@x".
+ *
+ *         Huge lists of numbers can be converted by several threads with
+ *         convertInParallel() (see "Parallel conversion" below).
+ *
  *
  *     Options can be mandatory, most of them can have a default value and
  *     passing the description information will autogenerate the usage legend,
@@ -142,6 +153,9 @@
  *     we do this in order to provide an easy way to recover them without needed to do some
  *     extra parsing of argv.
  *
+ *     If you don't need copies of them, "parseViews()" does the same but returns the other
+ *     arguments as std::string_view slices of argv (nothing gets copied).
+ *
  *     Later, on your program, you can use the following methods to inspect the options:
  *
  *          a. bool isSet() : will return you true if the option was specified, false otherwise
@@ -154,6 +168,9 @@
  *                                      StringListOption will return a list of strings:
  *                                           std::list< std::string >
  *                                      and so on...
+ *
+ *             List options keep their values contiguous, and they can be read without
+ *             copying them with "getValues()" (a const std::vector<TYPE>&) or "getSpan()".
  *                                                                                    
  *
  *      Also please note, that's highly convenient to check is the option was set, prior to get
@@ -270,9 +287,39 @@
 #include <sstream>
 #include <list>
 #include <cctype>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <charconv>
+#include <system_error>
+#include <stdexcept>
+#include <string_view>
+
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <typeinfo>
+#include <cstdint>
 
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 // helpers
@@ -302,352 +349,4709 @@ T fromString(const std::string& str) {
     return result;
 }
 
-// which kind of option types will required
-// and argument to be specified.
-// Booleans are the only ones that don't need
-// addition parameters as they're only used
-// as flags
-template<typename T>
-inline bool needsArgument() {
-    return true;
-}
-
-template<>
-inline bool needsArgument<bool>() {
-    return false;
-}
-
 
 /*
- * The goal is able to simple parse cmd line options:
+ * Converters: they turn the text of an argument into a TYPE value
+ * in a single pass, without building any temporary string.
  *
- *  program [--debug|-d] [--file=prueba|--file prueba|-f prueba]
+ * The numeric types use std::from_chars, any other type goes thru
+ * the canBeConvertedTo and fromString helpers, so those are still
+ * a valid way to support your own types. Specializing Converter
+ * is the faster one:
  *
+ *      template<>
+ *      struct Converter<Color> {
+ *          static ConversionResult convert(const char* text, size_t length, Color& value);
+ *      };
+ *
+ * The value must only be written when the conversion succeeds.
  */
 
-class BaseOption {
-
-    public:
+enum ConversionStatus {
+    CONVERSION_OK = 0,
+    CONVERSION_EMPTY,           // there is nothing to convert
+    CONVERSION_INVALID,         // it doesn't look like a TYPE at all
+    CONVERSION_OUT_OF_RANGE,    // valid, but doesn't fit in a TYPE
+    CONVERSION_TRAILING         // valid, but followed by more chars
+};
 
-    static const char NO_OPTION = 0;
+struct ConversionResult {
 
-    BaseOption(char sOption, const char* lOption, bool mandat, bool fArgument, const char* descr = "")
-     : shortOption(sOption), longOption(lOption), mandatory(mandat), followsArgument(fArgument), description(descr),
-       found(false)
+    ConversionResult(ConversionStatus st = CONVERSION_OK, size_t pos = 0)
+     : status(st), position(pos)
     {}
 
-    bool isSet() {
-        return found;
-    }
+    bool ok() const { return status == CONVERSION_OK; }
 
-    void markAsFound() {
-        found = true;
+    const char* describe() const {
+        switch ( status ) {
+            case CONVERSION_OK:             return "ok";
+            case CONVERSION_EMPTY:          return "empty value";
+            case CONVERSION_INVALID:        return "invalid value";
+            case CONVERSION_OUT_OF_RANGE:   return "value out of range";
+            case CONVERSION_TRAILING:       return "unexpected characters";
+        }
+        return "unknown error";
     }
 
-    bool matches(char shOption) const {
-        return ( shOption == shortOption );
-    }
+    ConversionStatus status;
+    size_t           position; // where the problem was found
+};
 
-    bool matches(const std::string& lOption) const {
-        return ( toLower(lOption) == toLower(longOption) );
-    }
+template<typename T>
+struct Converter {
 
-    std::string toLower(const std::string& original) const {
-        std::string lc = original;
+    static ConversionResult convert(const char* text, size_t length, T& value) {
 
-        for(int index=0; index<lc.size(); ++index)
-            lc[index] = std::tolower(lc[index]);
+        std::string str(text, length);
 
-        return lc;
-    }
+        if ( ! canBeConvertedTo<T>(str) )
+            return ConversionResult(CONVERSION_INVALID);
 
-    int bestMatch(const std::string& lOption) const {
+        value = fromString<T>(str);
 
-        // The idea is to determine the number of chars
-        // that matches the requested option
-        int matches = 0;
+        return ConversionResult();
+    }
 
-        // is greater don't waste time
-        if ( lOption.size() > longOption.size() )
-            return matches;
+};
 
-        for(int index=0; index < lOption.size(); ++index) {
-            if ( std::tolower(lOption[index]) == std::tolower(longOption[index]) )
-                matches++;
-            else
-                return matches;
-        }
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
 
-        return matches;
+template<typename T>
+ConversionResult convertNumber(const char* text, size_t length, T& value) {
 
-    }
+    const char* begin = text;
+    const char* end   = text + length;
 
-    bool needArgument() const { return followsArgument; }
-    bool isMandatory()  const { return mandatory; }
+    // as the streams did, let's allow blanks around
+    // the number and an explicit '+' sign
+    while ( begin != end && isBlank(*begin) )
+        ++begin;
 
-    virtual void setValue(const char* readValue) = 0;
+    while ( end != begin && isBlank(*(end-1)) )
+        --end;
 
-    bool hasShortOption() const {
-        return (shortOption != NO_OPTION);
-    }
+    if ( begin == end )
+        return ConversionResult(CONVERSION_EMPTY, begin - text);
 
-    bool hasLongOption() const {
-        return !longOption.empty();
+    if ( *begin == '+' && end - begin > 1 && begin[1] != '-' && begin[1] != '+' )
+        ++begin;
+
+    // from_chars doesn't take a sign for the unsigned types, but
+    // a negative number is a number: it just doesn't fit
+    if constexpr ( std::is_unsigned<T>::value ) {
+        if ( *begin == '-' && end - begin > 1 && isdigit((unsigned char) begin[1]) )
+            return ConversionResult(CONVERSION_OUT_OF_RANGE, begin - text);
     }
 
-    char getShortOption()  const { return shortOption; }
-    std::string getLongOption() const { return longOption;  }
+    std::from_chars_result result = std::from_chars(begin, end, value);
 
+    if ( result.ec == std::errc::invalid_argument )
+        return ConversionResult(CONVERSION_INVALID, begin - text);
 
-    std::string getDescription() const { return description; }
+    if ( result.ec == std::errc::result_out_of_range )
+        return ConversionResult(CONVERSION_OUT_OF_RANGE, begin - text);
 
-    protected:
-    // configuration
-    char    shortOption;
-    std::string  longOption;
-    bool    mandatory;
-    bool    followsArgument;
-    std::string  description;
+    if ( result.ptr != end )
+        return ConversionResult(CONVERSION_TRAILING, result.ptr - text);
 
-    // status & value
-    bool    found; // was it found?
+    return ConversionResult();
+}
 
+template<>
+struct Converter<int> {
+    static ConversionResult convert(const char* text, size_t length, int& value) {
+        return convertNumber(text, length, value);
+    }
 };
 
+template<>
+struct Converter<long> {
+    static ConversionResult convert(const char* text, size_t length, long& value) {
+        return convertNumber(text, length, value);
+    }
+};
 
-template<typename TYPE>
-class Option : public BaseOption {
-
-    public:
-    Option(char sOption, const char* lOption, bool mandatory, const char* descr = "")
-     : BaseOption(sOption, lOption, mandatory, needsArgument<TYPE>(), descr)
-    {}
-
-    Option(char sOption, const char* lOption, bool mandatory, const TYPE& defValue, const char* descr = "")
-     : BaseOption(sOption, lOption, mandatory, needsArgument<TYPE>(), descr), defaultValue(defValue)
-    {}
-
-    // implement according the Option type...
-    // only the dev can know how to convert from a std::string
-    // to a TYPE type
-    // The developer can provide some specialization of the
-    // canBeConvertedTo and fromString functions, or he can
-    // completely override the setValue method
-    virtual void setValue(const char* readValue) {
-
-        if ( canBeConvertedTo<TYPE>( readValue ) ) {
+template<>
+struct Converter<short> {
+    static ConversionResult convert(const char* text, size_t length, short& value) {
+        return convertNumber(text, length, value);
+    }
+};
 
-            markAsFound();
+template<>
+struct Converter<unsigned short> {
+    static ConversionResult convert(const char* text, size_t length, unsigned short& value) {
+        return convertNumber(text, length, value);
+    }
+};
 
-            value = fromString<TYPE>( readValue );
-        }
+template<>
+struct Converter<unsigned int> {
+    static ConversionResult convert(const char* text, size_t length, unsigned int& value) {
+        return convertNumber(text, length, value);
     }
+};
 
-    TYPE getValue() {
+template<>
+struct Converter<unsigned long> {
+    static ConversionResult convert(const char* text, size_t length, unsigned long& value) {
+        return convertNumber(text, length, value);
+    }
+};
 
-        if ( ! found )
-            return defaultValue;
-        else
-            return value;
+template<>
+struct Converter<long long> {
+    static ConversionResult convert(const char* text, size_t length, long long& value) {
+        return convertNumber(text, length, value);
+    }
+};
 
+template<>
+struct Converter<unsigned long long> {
+    static ConversionResult convert(const char* text, size_t length, unsigned long long& value) {
+        return convertNumber(text, length, value);
     }
+};
 
+template<>
+struct Converter<float> {
+    static ConversionResult convert(const char* text, size_t length, float& value) {
+        return convertNumber(text, length, value);
+    }
+};
 
-    protected:
-    // configuration
-    TYPE    value;
-    TYPE    defaultValue;
+template<>
+struct Converter<double> {
+    static ConversionResult convert(const char* text, size_t length, double& value) {
+        return convertNumber(text, length, value);
+    }
 };
 
-template<typename TYPE>
-class ListOption : public BaseOption {
+// strings keep the stream behaviour: the first word is the value
+template<>
+struct Converter<std::string> {
+    static ConversionResult convert(const char* text, size_t length, std::string& value) {
 
-    public:
-    ListOption(char sOption, const char* lOption, bool mandatory, const char* descr = "")
-     : BaseOption(sOption, lOption, mandatory, true, descr)
-    {}
+        size_t begin = 0;
 
-    ListOption(char sOption, const char* lOption, bool mandatory, const std::list<TYPE>& defValue, const char* descr = "")
-     : BaseOption(sOption, lOption, mandatory, true, descr), defaultValue(defValue)
-    {}
+        while ( begin < length && isBlank(text[begin]) )
+            ++begin;
 
-    // implement according the Option type...
-    // only the dev can know how to convert from a std::string
-    // to a TYPE type
-    // The developer can provide some specialization of the
-    // canBeConvertedTo and fromString functions, or he can
-    // completely override the setValue method
-    virtual void setValue(const char* readValue) {
+        size_t end = begin;
 
-        if ( canBeConvertedTo<TYPE>( readValue ) ) {
+        while ( end < length && !isBlank(text[end]) )
+            ++end;
 
-            markAsFound();
+        if ( begin == end )
+            return ConversionResult(CONVERSION_EMPTY, begin);
 
-            value.push_back(fromString<TYPE>( readValue ) );
-        }
-    }
+        value.assign(text + begin, end - begin);
 
-    std::list<TYPE> getValue() {
+        return ConversionResult();
+    }
+};
 
-        if ( ! found )
-            return defaultValue;
-        else
-            return value;
+// the same word, but as a view of the text itself (nothing is copied),
+// it's valid as long as the text is: argv, or a file read by the parse
+template<>
+struct Converter<std::string_view> {
+    static ConversionResult convert(const char* text, size_t length, std::string_view& value) {
 
-    }
+        size_t begin = 0;
 
+        while ( begin < length && isBlank(text[begin]) )
+            ++begin;
 
-    protected:
-    // configuration
-    std::list<TYPE> value;
-    std::list<TYPE> defaultValue;
-};
+        size_t end = begin;
 
-class BoolOption : public Option<bool> {
+        while ( end < length && !isBlank(text[end]) )
+            ++end;
 
-    public:
+        if ( begin == end )
+            return ConversionResult(CONVERSION_EMPTY, begin);
 
-    BoolOption(char sOption, const char* lOption, bool mandatory, const char* descr = "")
-     : Option<bool>(sOption, lOption, mandatory, false, descr)
-    {}
+        value = std::string_view(text + begin, end - begin);
 
-    bool getValue() {
-        return found;
+        return ConversionResult();
     }
-
 };
 
 
-typedef Option<std::string>     StringOption;
-typedef Option<int>             IntegerOption;
-typedef Option<float>           FloatOption;
-typedef Option<double>          DoubleOption;
+/*
+ * Text kernels
+ *
+ * The loops over the text of the arguments and of the option names.
+ * They work on 32 chars at a time with AVX2, 16 with SSE2 (when the
+ * compiler targets them, ie: -mavx2) and one by one otherwise, giving
+ * the same results in every case.
+ */
 
-typedef ListOption<std::string> StringListOption;
-typedef ListOption<int>         IntegerListOption;
-typedef ListOption<float>       FloatListOption;
-typedef ListOption<double>      DoubleListOption;
+// ASCII case folding, the one used to compare the option names
+inline constexpr char foldChar(char c) {
+    return ( c >= 'A' && c <= 'Z' ) ? (char) (c - 'A' + 'a') : c;
+}
 
+#if defined(__AVX2__)
 
-template<typename T>
-class RangeNumberOption : public ListOption<T> {
+// the chars equal to "c", one bit per char
+inline unsigned int matchMask(const char* text, char c) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+    return _mm256_movemask_epi8( _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c)) );
+}
 
-    public:
+inline __m256i foldBlock(__m256i block) {
 
-    RangeNumberOption(char sOption, const char* lOption, bool mandatory, const char* descr = "")
-     : ListOption<T>(sOption, lOption, mandatory, descr)
-    {}
+    // bytes over 0x7f are negative, so they're never upper case
+    __m256i upper = _mm256_and_si256( _mm256_cmpgt_epi8(block, _mm256_set1_epi8('A' - 1)),
+                                      _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), block) );
 
-    RangeNumberOption(char sOption, const char* lOption, bool mandatory, const std::list<T>& defaultValue, const char* descr = "")
-     : ListOption<T>(sOption, lOption, mandatory, defaultValue, descr)
-    {}
+    return _mm256_or_si256( block, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)) );
+}
 
-    void setValue(const char* readValue) {
+#elif defined(__SSE2__)
 
-        std::string fullRange = readValue;
-        size_t pos = fullRange.find(",");
+inline unsigned int matchMask(const char* text, char c) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+    return _mm_movemask_epi8( _mm_cmpeq_epi8(block, _mm_set1_epi8(c)) );
+}
 
-        std::string begin = fullRange.substr(0, pos); 
-        std::string end;
+inline __m128i foldBlock(__m128i block) {
 
-        if ( fullRange.find(",", pos) != std::string::npos ) {
-            end = fullRange.substr(pos + 1);
-        }
+    __m128i upper = _mm_and_si128( _mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)),
+                                   _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1)) );
 
-        if ( end.size() != 0 ) {
-            ListOption<T>::setValue(begin.c_str());
-            ListOption<T>::setValue(end.c_str());
-        } // if is 0 some error occur in the params
+    return _mm_or_si128( block, _mm_and_si128(upper, _mm_set1_epi8(0x20)) );
+}
 
-    }
+#endif
 
-};
+#if defined(__AVX2__)
+static const size_t TEXT_BLOCK = 32;
+#elif defined(__SSE2__)
+static const size_t TEXT_BLOCK = 16;
+#endif
 
-typedef RangeNumberOption<int>   IntegerRange;
-typedef RangeNumberOption<float> FloatRange;
-typedef RangeNumberOption<long>  LongRange;
+// the position of the first "c", or "length" if there is none
+inline size_t findChar(const char* text, size_t length, char c) {
 
-class Parser {
+    size_t index = 0;
 
-    public:
-    Parser() : helpOption('h', "help", false, "print this help") {
-        // we provide the help option by default
-        addOption(helpOption);
+#if defined(__AVX2__) || defined(__SSE2__)
+    for(; index + TEXT_BLOCK <= length; index += TEXT_BLOCK) {
+
+        unsigned int mask = matchMask(text + index, c);
+
+        if ( mask != 0 )
+            return index + __builtin_ctz(mask);
     }
+#endif
 
-    Parser& addOption(BaseOption& option) {
-        options.push_back(&option);
-        return *this;
+    for(; index < length; ++index) {
+        if ( text[index] == c )
+            return index;
     }
 
-    std::vector<std::string> parse(int argc, char** argv);
+    return length;
+}
 
-    void usage(const std::string& text) { usage(text.c_str()); }
-    void usage(const char* text = "");
+inline size_t countChar(const char* text, size_t length, char c) {
 
-    private:
-    BoolOption helpOption;
+    size_t index = 0;
+    size_t count = 0;
 
-    std::vector<BaseOption*> options;
-    std::string programName;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for(; index + TEXT_BLOCK <= length; index += TEXT_BLOCK)
+        count += __builtin_popcount( matchMask(text + index, c) );
+#endif
 
-    BaseOption* findOption(char shortOpt);
-    BaseOption* findOption(std::string longOpt);
+    for(; index < length; ++index)
+        count += ( text[index] == c );
 
-    std::string getSummaryOptionText(BaseOption* option) {
-        return getOptionText(option, "|");
-    }
+    return count;
+}
 
-    std::string getFullOptionText(BaseOption* option) {
-        return getOptionText(option, ", ");
-    }
+// "out" can be "text" itself
+inline void foldText(const char* text, size_t length, char* out) {
 
-    std::string getOptionText(BaseOption* option, const char* separator);
+    size_t index = 0;
 
-};
+#if defined(__AVX2__)
+    for(; index + TEXT_BLOCK <= length; index += TEXT_BLOCK) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + index));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + index), foldBlock(block));
+    }
+#elif defined(__SSE2__)
+    for(; index + TEXT_BLOCK <= length; index += TEXT_BLOCK) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + index), foldBlock(block));
+    }
+#endif
 
-std::vector<std::string>
-Parser::parse(int argc, char** argv) {
+    for(; index < length; ++index)
+        out[index] = foldChar(text[index]);
+}
 
-    std::vector<std::string> otherArguments;
+inline std::string foldString(const char* text, size_t length) {
+    std::string folded(text, length);
 
-    // first argument is the program name
-    if ( argc >= 1 )
-        programName = argv[0];
+    foldText(folded.data(), length, folded.data());
 
-    // now, start iterating over each argument
-    for(int argNumber=1; argNumber < argc; ++argNumber) {
+    return folded;
+}
 
-        std::string argument = argv[argNumber];
+// how many of the first "length" chars are equal, ignoring the case
+inline size_t foldedPrefixLength(const char* a, const char* b, size_t length) {
 
-        // arguments start with "-"
-        // if not, push it into "other inputs"
-        if ( argument.empty() )
-            continue;
+    size_t index = 0;
 
-        if ( argument[0] != '-' ) {
-            // add it as other argument and continue with the next arg
-            otherArguments.push_back( argument );
-            continue;        
-        }
+#if defined(__AVX2__)
+    for(; index + TEXT_BLOCK <= length; index += TEXT_BLOCK) {
 
-        // this is a malformed argument:
-        // "-"
-        if ( argument.length() < 2 ) {
-            std::stringstream error;
-            error << "Malformed argument! (see arg number " << argNumber << ")";
-            usage(error.str());
-        }
+        __m256i blockA = foldBlock( _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + index)) );
+        __m256i blockB = foldBlock( _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + index)) );
 
-        BaseOption* option = NULL;
+        unsigned int different = ~ (unsigned int) _mm256_movemask_epi8( _mm256_cmpeq_epi8(blockA, blockB) );
 
-        std::string possibleValue;
+        if ( different != 0 )
+            return index + __builtin_ctz(different);
+    }
+#elif defined(__SSE2__)
+    for(; index + TEXT_BLOCK <= length; index += TEXT_BLOCK) {
 
-        // now, if the next char is a '-' it's a long option,
-        // if not, it's a short one
-        if ( argument[1] != '-' ) {
+        __m128i blockA = foldBlock( _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + index)) );
+        __m128i blockB = foldBlock( _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + index)) );
 
-            option = findOption(argument[1]);
+        unsigned int different = 0xffff & ~ (unsigned int) _mm_movemask_epi8( _mm_cmpeq_epi8(blockA, blockB) );
+
+        if ( different != 0 )
+            return index + __builtin_ctz(different);
+    }
+#endif
+
+    for(; index < length; ++index) {
+        if ( foldChar(a[index]) != foldChar(b[index]) )
+            return index;
+    }
+
+    return length;
+}
+
+// how many of the first chars are not blanks, quotes nor
+// backslashes (the ones the argument splitters care about)
+inline size_t plainLength(const char* text, size_t length) {
+
+    size_t index = 0;
+
+#if defined(__AVX2__)
+    for(; index + TEXT_BLOCK <= length; index += TEXT_BLOCK) {
+
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + index));
+
+        // '\t' to '\r' are the blanks below the space
+        __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8('\t'));
+        __m256i special = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\'')));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\')));
+
+        unsigned int mask = _mm256_movemask_epi8(special);
+
+        if ( mask != 0 )
+            return index + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    for(; index + TEXT_BLOCK <= length; index += TEXT_BLOCK) {
+
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index));
+
+        __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+        __m128i special = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(block, _mm_set1_epi8('"')));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(block, _mm_set1_epi8('\'')));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(block, _mm_set1_epi8('\\')));
+
+        unsigned int mask = _mm_movemask_epi8(special);
+
+        if ( mask != 0 )
+            return index + __builtin_ctz(mask);
+    }
+#endif
+
+    for(; index < length; ++index) {
+
+        char c = text[index];
+
+        if ( isBlank(c) || c == '"' || c == '\'' || c == '\\' )
+            return index;
+    }
+
+    return length;
+}
+
+// the leading digits of the next eight chars, converted at once (SWAR).
+// Returns how many digits there are (eight means there could be more)
+inline size_t parseDigits(const char* text, unsigned long long& value) {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    unsigned long long chunk;
+    memcpy(&chunk, text, 8);
+
+    chunk -= 0x3030303030303030ULL;
+
+    // a char below '0' wraps to the high bit, and one over '9' gets
+    // there adding 0x76 (chars after the first one that is not a
+    // digit can be wrong, but they're not used)
+    unsigned long long other = ( chunk | (chunk + 0x7676767676767676ULL) ) & 0x8080808080808080ULL;
+
+    size_t digits = ( other != 0 ) ? __builtin_ctzll(other) / 8 : 8;
+
+    if ( digits == 0 )
+        return 0;
+
+    // leading zeros instead of the chars after the digits
+    chunk <<= 8 * (8 - digits);
+
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = ( ( (chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) ) +
+              ( ( (chunk >> 16) & 0x000000FF000000FFULL ) * (1 + (10000ULL << 32)) ) ) >> 32;
+
+    value = chunk;
+
+    return digits;
+#else
+    size_t digits = 0;
+
+    value = 0;
+
+    while ( digits < 8 && text[digits] >= '0' && text[digits] <= '9' )
+        value = value * 10 + (text[digits++] - '0');
+
+    return digits;
+#endif
+}
+
+
+// a check cheaper than the conversion itself, used by the lazy options
+// (see BaseOption::convertLazily): when it's ok, the conversion of the
+// same text must be ok too. By default it's the conversion itself
+template<typename T>
+inline ConversionResult checkValue(const char* text, size_t length) {
+
+    T converted;
+
+    return Converter<T>::convert( text, length, converted );
+}
+
+// short numbers made of digits only can't be wrong,
+// the rest is checked converting them
+template<typename T>
+ConversionResult checkInteger(const char* text, size_t length) {
+
+    const char* begin = text;
+    const char* end   = text + length;
+
+    while ( begin != end && isBlank(*begin) )
+        ++begin;
+
+    while ( end != begin && isBlank(*(end-1)) )
+        --end;
+
+    if ( begin != end && ( *begin == '-' || *begin == '+' ) )
+        ++begin;
+
+    bool simple = ( begin != end && end - begin <= std::numeric_limits<T>::digits10 );
+
+    for(const char* pos = begin; simple && pos != end; ++pos)
+        simple = ( *pos >= '0' && *pos <= '9' );
+
+    if ( simple )
+        return ConversionResult();
+
+    T converted;
+
+    return Converter<T>::convert( text, length, converted );
+}
+
+template<>
+inline ConversionResult checkValue<int>(const char* text, size_t length) {
+    return checkInteger<int>( text, length );
+}
+
+template<>
+inline ConversionResult checkValue<long>(const char* text, size_t length) {
+    return checkInteger<long>( text, length );
+}
+
+// any word will do, there is no need to copy it
+template<>
+inline ConversionResult checkValue<std::string>(const char* text, size_t length) {
+
+    size_t begin = 0;
+
+    while ( begin < length && isBlank(text[begin]) )
+        ++begin;
+
+    if ( begin == length )
+        return ConversionResult(CONVERSION_EMPTY, begin);
+
+    return ConversionResult();
+}
+
+
+/*
+ * Numeric lists
+ *
+ * The list options of numbers take several values at once, separated
+ * by commas ("--ids=1,2,3"), so huge lists don't need the option again
+ * for each value. Integers are converted eight digits at a time (see
+ * parseDigits), the rest of the values one by one.
+ */
+
+// (the char types are characters, not numbers: a list of
+// chars keeps "5" as '5', as Option<char> does)
+template<typename T>
+struct IsCharacter {
+    static const bool value = std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+                              std::is_same<T, unsigned char>::value || std::is_same<T, wchar_t>::value ||
+                              std::is_same<T, char16_t>::value || std::is_same<T, char32_t>::value;
+};
+
+template<typename T>
+struct IsNumberList {
+    static const bool value = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value && !IsCharacter<T>::value;
+};
+
+// the types where any "[-]digits" number of up to eight digits fits,
+// the rest (short, unsigned...) are range checked by their Converter
+template<typename T>
+struct HasFastDigits {
+    static const bool value = std::is_same<T, int>::value || std::is_same<T, long>::value ||
+                              std::is_same<T, long long>::value;
+};
+
+// appends all the numbers, or none of them if any is wrong
+template<typename T>
+ConversionResult appendNumbers(std::vector<T>& values, const char* text, size_t length) {
+
+    size_t previousSize = values.size();
+
+    values.reserve( previousSize + countChar(text, length, ',') + 1 );
+
+    size_t begin = 0;
+
+    while ( true ) {
+
+        size_t end = length;
+
+        if constexpr ( HasFastDigits<T>::value ) {
+
+            // "[-]digits" (up to eight of them) are converted here, anything
+            // else (blanks, signs, longer numbers) goes the long way
+            bool negative = ( begin < length && text[begin] == '-' );
+            size_t first  = begin + negative;
+
+            unsigned long long number = 0;
+            size_t digits;
+
+            if ( first + 8 <= length ) {
+                digits = parseDigits(text + first, number);
+            }
+            else {
+                char padded[8] = { ',', ',', ',', ',', ',', ',', ',', ',' };
+                memcpy(padded, text + first, length - first);
+                digits = parseDigits(padded, number);
+            }
+
+            end = first + digits;
+
+            if ( digits > 0 && ( end == length || text[end] == ',' ) ) {
+
+                values.push_back( negative ? (T) - (long long) number : (T) number );
+
+                if ( end == length )
+                    return ConversionResult();
+
+                begin = end + 1;
+                continue;
+            }
+        }
+
+        end = begin + findChar(text + begin, length - begin, ',');
+
+        T value;
+        ConversionResult result = Converter<T>::convert( text + begin, end - begin, value );
+
+        if ( ! result.ok() ) {
+            values.resize(previousSize);
+            result.position += begin;
+            return result;
+        }
+
+        values.push_back(value);
+
+        if ( end == length )
+            return ConversionResult();
+
+        begin = end + 1;
+    }
+}
+
+template<typename T>
+ConversionResult checkNumbers(const char* text, size_t length) {
+
+    size_t begin = 0;
+
+    while ( true ) {
+
+        size_t end = begin + findChar(text + begin, length - begin, ',');
+
+        ConversionResult result = checkValue<T>( text + begin, end - begin );
+
+        if ( ! result.ok() ) {
+            result.position += begin;
+            return result;
+        }
+
+        if ( end == length )
+            return ConversionResult();
+
+        begin = end + 1;
+    }
+}
+
+
+/*
+ * Parallel conversion
+ *
+ * Huge lists (ie: "--ids=1,2,3,..." with millions of numbers) can be
+ * converted by several threads (see BaseOption::convertInParallel).
+ * The text is split at the commas in one piece per thread, each piece
+ * is converted into its own vector and they're appended in order, so
+ * the values are the same as converting it at once. When more than one
+ * piece is wrong the error is the one of the first of them (the one
+ * found converting it at once).
+ *
+ * The threads belong to a pool shared by all the options, started the
+ * first time it's needed and kept (never stopped) for the next ones.
+ */
+
+// pieces smaller than these are not worth a thread
+enum {
+    PARALLEL_MIN_CHARS  = 64 * 1024,    // of a comma list
+    PARALLEL_MIN_VALUES = 8 * 1024      // pending values of a lazy list
+};
+
+class ConversionPool {
+
+    public:
+
+    // (it's never destroyed, so the threads can wait for work
+    // until the program ends)
+    static ConversionPool& shared() {
+        static ConversionPool* pool = new ConversionPool();
+        return *pool;
+    }
+
+    // the threads to use when "threads" is 0
+    static size_t defaultThreads() {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // calls task(0) ... task(count - 1), on the pool threads and the
+    // caller one, and returns when all of them are done
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    private:
+
+    ConversionPool() : task(NULL), count(0), next(0), done(0), owner(getpid()) {}
+
+    // one run at a time
+    std::mutex running;
+
+    std::mutex              mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable finished;
+
+    std::vector<std::thread> threads;
+
+    const std::function<void(size_t)>* task;
+    size_t  count;
+    size_t  next;
+    size_t  done;
+
+    // a forked child has no threads (but the caller one)
+    pid_t   owner;
+
+    void work();
+};
+
+void
+ConversionPool::run(size_t taskCount, const std::function<void(size_t)>& function) {
+
+    if ( taskCount <= 1 || getpid() != owner ) {
+
+        for(size_t index=0; index < taskCount; ++index)
+            function(index);
+
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(running);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while ( threads.size() + 1 < taskCount )
+        threads.push_back( std::thread(&ConversionPool::work, this) );
+
+    task  = &function;
+    count = taskCount;
+    next  = 0;
+    done  = 0;
+
+    wakeUp.notify_all();
+
+    // the caller takes its share too
+    while ( next < count ) {
+
+        size_t index = next++;
+
+        lock.unlock();
+        function(index);
+        lock.lock();
+
+        ++done;
+    }
+
+    finished.wait(lock, [this] { return done == count; });
+
+    task  = NULL;
+    count = 0;
+}
+
+void
+ConversionPool::work() {
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while ( true ) {
+
+        wakeUp.wait(lock, [this] { return task != NULL && next < count; });
+
+        size_t index = next++;
+        const std::function<void(size_t)>* current = task;
+
+        lock.unlock();
+        (*current)(index);
+        lock.lock();
+
+        if ( ++done == count )
+            finished.notify_one();
+    }
+}
+
+// the same as appendNumbers(), but the pieces of the list
+// are converted by up to "threads" threads (0 for all of them)
+template<typename T>
+ConversionResult appendNumbersInParallel(std::vector<T>& values, const char* text, size_t length, size_t threads) {
+
+    if ( threads == 0 )
+        threads = ConversionPool::defaultThreads();
+
+    size_t pieces = std::min(threads, length / PARALLEL_MIN_CHARS);
+
+    if ( pieces <= 1 )
+        return appendNumbers( values, text, length );
+
+    // where each piece begins and ends (a comma
+    // ends it, near its share of the text)
+    std::vector<size_t> begins;
+    std::vector<size_t> ends;
+
+    size_t begin = 0;
+
+    for(size_t piece=1; piece < pieces; ++piece) {
+
+        size_t target = piece * (length / pieces);
+
+        if ( target <= begin )
+            continue;
+
+        size_t comma = target + findChar(text + target, length - target, ',');
+
+        if ( comma == length )
+            break;
+
+        begins.push_back(begin);
+        ends.push_back(comma);
+
+        begin = comma + 1;
+    }
+
+    begins.push_back(begin);
+    ends.push_back(length);
+
+    std::vector< std::vector<T> >   converted(begins.size());
+    std::vector<ConversionResult>   results(begins.size());
+
+    ConversionPool::shared().run(begins.size(), [&](size_t piece) {
+        results[piece] = appendNumbers( converted[piece], text + begins[piece], ends[piece] - begins[piece] );
+    });
+
+    size_t total = 0;
+
+    for(size_t piece=0; piece < begins.size(); ++piece) {
+
+        // as appendNumbers(), nothing is added if any is wrong
+        if ( ! results[piece].ok() ) {
+            results[piece].position += begins[piece];
+            return results[piece];
+        }
+
+        total += converted[piece].size();
+    }
+
+    values.reserve( values.size() + total );
+
+    for(size_t piece=0; piece < begins.size(); ++piece)
+        values.insert( values.end(), converted[piece].begin(), converted[piece].end() );
+
+    return ConversionResult();
+}
+
+
+// heap memory held by a value (besides its own sizeof), used by the
+// parse statistics. Specialize it for your types if they allocate
+template<typename T>
+inline size_t heapBytes(const T& value) {
+    return 0;
+}
+
+template<>
+inline size_t heapBytes<std::string>(const std::string& value) {
+    // short strings are stored within the object itself
+    return ( value.capacity() > std::string().capacity() ) ? value.capacity() + 1 : 0;
+}
+
+template<typename T>
+inline size_t heapBytes(const std::vector<T>& values) {
+
+    size_t bytes = values.capacity() * sizeof(T);
+
+    for(size_t index=0; index < values.size(); ++index)
+        bytes += heapBytes(values[index]);
+
+    return bytes;
+}
+
+
+// which kind of option types will required
+// and argument to be specified.
+// Booleans are the only ones that don't need
+// addition parameters as they're only used
+// as flags
+template<typename T>
+inline bool needsArgument() {
+    return true;
+}
+
+template<>
+inline bool needsArgument<bool>() {
+    return false;
+}
+
+
+/*
+ * Values of an option stored out of it, by a ParseResult. Each option
+ * creates the kind of value it needs (see BaseOption::newValue).
+ */
+
+// (see ParseSnapshot)
+class SnapshotWriter;
+struct SnapshotEntry;
+
+class OptionValue {
+
+    public:
+
+    OptionValue() : found(false) {}
+
+    virtual ~OptionValue() {}
+
+    virtual void clear() { found = false; }
+
+    virtual size_t getValueBytes() const { return 0; }
+
+    // writes the value in a snapshot, false if it can't be
+    // written (options without a value only need the found flag)
+    virtual bool writeSnapshot(SnapshotWriter& writer, SnapshotEntry& entry) const { return true; }
+
+    bool found;
+};
+
+template<typename T>
+class IntervalSet;
+
+template<typename VALUE>
+class StoredValue : public OptionValue {
+
+    public:
+
+    StoredValue(const VALUE& initial = VALUE()) : value(initial) {}
+
+    virtual void clear() {
+        OptionValue::clear();
+        clearValue(value);
+    }
+
+    virtual size_t getValueBytes() const {
+        return sizeof(VALUE) + heapBytes(value);
+    }
+
+    virtual bool writeSnapshot(SnapshotWriter& writer, SnapshotEntry& entry) const {
+        return writeSnapshotValue(writer, entry, value);
+    }
+
+    VALUE value;
+
+    private:
+
+    // lists are emptied (keeping its memory), other
+    // values are just hidden by the found flag
+    template<typename T>
+    static void clearValue(T& value) {}
+
+    template<typename T>
+    static void clearValue(std::vector<T>& values) { values.clear(); }
+
+    template<typename T>
+    static void clearValue(IntervalSet<T>& values) { values.clear(); }
+};
+
+
+// null terminated copies of texts, packed in big blocks
+// (freed all together, with the arena)
+class TextArena {
+
+    public:
+
+    TextArena() : next(NULL), left(0) {}
+
+    char* allocate(size_t size);
+
+    std::string_view copy(std::string_view text) {
+
+        char* copy = allocate(text.size() + 1);
+
+        memcpy(copy, text.data(), text.size());
+        copy[text.size()] = '\0';
+
+        return std::string_view(copy, text.size());
+    }
+
+    private:
+
+    TextArena(const TextArena&);
+    TextArena& operator=(const TextArena&);
+
+    enum { BLOCK_SIZE = 64 * 1024 };
+
+    std::vector< std::unique_ptr<char[]> > blocks;
+    char*   next;
+    size_t  left;
+};
+
+char*
+TextArena::allocate(size_t size) {
+
+    // the big ones get a block of its own
+    if ( size > BLOCK_SIZE / 4 ) {
+        blocks.push_back( std::unique_ptr<char[]>(new char[size]) );
+        return blocks.back().get();
+    }
+
+    if ( size > left ) {
+        blocks.push_back( std::unique_ptr<char[]>(new char[BLOCK_SIZE]) );
+        next = blocks.back().get();
+        left = BLOCK_SIZE;
+    }
+
+    char* text = next;
+
+    next += size;
+    left -= size;
+
+    return text;
+}
+
+
+/*
+ * String pool
+ *
+ * The names and descriptions of the options are not copied into each
+ * option, they're interned in a pool shared by all of them: the texts
+ * are packed in big blocks (never freed) and equal texts are stored
+ * once, so thousands of options cost a few allocations, not several
+ * per option. The options built from an OptionSpec don't even use the
+ * pool, they point to the (static) texts of the spec.
+ */
+
+class StringPool {
+
+    public:
+
+    StringPool() : count(0) {}
+
+    // the one used by the options
+    static StringPool& shared() {
+        static StringPool pool;
+        return pool;
+    }
+
+    // a null terminated copy of "text", the same one for equal texts
+    std::string_view intern(std::string_view text);
+
+    private:
+
+    StringPool(const StringPool&);
+    StringPool& operator=(const StringPool&);
+
+    std::mutex mutex;
+
+    TextArena arena;
+
+    // open addressing, by hash (the size is a power of 2)
+    std::vector<std::string_view> table;
+    size_t  count;
+
+    static size_t hash(std::string_view text) {
+
+        // FNV-1a
+        size_t value = 2166136261u;
+
+        for(size_t index=0; index < text.size(); ++index)
+            value = ( value ^ (unsigned char) text[index] ) * 16777619u;
+
+        return value;
+    }
+
+    std::string_view* findSlot(std::vector<std::string_view>& slots, std::string_view text) const {
+
+        size_t mask = slots.size() - 1;
+        size_t slot = hash(text) & mask;
+
+        while ( slots[slot].data() != NULL && slots[slot] != text )
+            slot = ( slot + 1 ) & mask;
+
+        return &slots[slot];
+    }
+};
+
+std::string_view
+StringPool::intern(std::string_view text) {
+
+    // (no need to keep them)
+    if ( text.empty() )
+        return std::string_view("", 0);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // at most half full
+    if ( 2 * (count + 1) > table.size() ) {
+
+        std::vector<std::string_view> bigger( std::max<size_t>(256, 2 * table.size()) );
+
+        for(size_t index=0; index < table.size(); ++index) {
+            if ( table[index].data() != NULL )
+                *findSlot(bigger, table[index]) = table[index];
+        }
+
+        table.swap(bigger);
+    }
+
+    std::string_view* slot = findSlot(table, text);
+
+    if ( slot->data() == NULL ) {
+        *slot = arena.copy(text);
+        ++count;
+    }
+
+    return *slot;
+}
+
+
+// (see the compile time schemas)
+struct OptionSpec;
+
+/*
+ * The goal is able to simple parse cmd line options:
+ *
+ *  program [--debug|-d] [--file=prueba|--file prueba|-f prueba]
+ *
+ */
+
+class BaseOption {
+
+    public:
+
+    static const char NO_OPTION = 0;
+
+    // the texts are interned in the shared StringPool
+    BaseOption(char sOption, const char* lOption, bool mandat, bool fArgument, const char* descr = "")
+     : shortOption(sOption),
+       longOption(StringPool::shared().intern(lOption)),
+       mandatory(mandat), followsArgument(fArgument),
+       description(StringPool::shared().intern(descr)),
+       lazy(false), found(false)
+    {}
+
+    // the texts are the ones of "spec", so it must outlive the
+    // option (ie: a static array of specs), nothing is allocated
+    BaseOption(const OptionSpec& spec, bool fArgument);
+
+    virtual ~BaseOption() {}
+
+    bool isSet() {
+        return found;
+    }
+
+    void markAsFound() {
+        found = true;
+    }
+
+    // forgets everything read by a previous parse
+    virtual void reset() {
+        found      = false;
+        conversion = ConversionResult();
+    }
+
+    bool matches(char shOption) const {
+        return ( shOption == shortOption );
+    }
+
+    bool matches(const std::string& lOption) const {
+        return lOption.size() == longOption.size() &&
+               foldedPrefixLength(lOption.data(), longOption.data(), lOption.size()) == lOption.size();
+    }
+
+    std::string toLower(const std::string& original) const {
+        return foldString(original.data(), original.size());
+    }
+
+    int bestMatch(const std::string& lOption) const {
+
+        // The idea is to determine the number of chars
+        // that matches the requested option
+
+        // is greater don't waste time
+        if ( lOption.size() > longOption.size() )
+            return 0;
+
+        return foldedPrefixLength(lOption.data(), longOption.data(), lOption.size());
+
+    }
+
+    bool needArgument() const { return followsArgument; }
+    bool isMandatory()  const { return mandatory; }
+
+    virtual void setValue(const char* readValue) = 0;
+
+    bool hasShortOption() const {
+        return (shortOption != NO_OPTION);
+    }
+
+    bool hasLongOption() const {
+        return !longOption.empty();
+    }
+
+    char getShortOption()  const { return shortOption; }
+
+    // copies of the texts, as they always were, and the texts themselves
+    // (views of the pool or the spec, null terminated) with no copies
+    std::string getLongOption()  const { return std::string(longOption);  }
+    std::string getDescription() const { return std::string(description); }
+
+    std::string_view getLongOptionView()  const { return longOption;  }
+    std::string_view getDescriptionView() const { return description; }
+
+    // how the last value given to setValue() was converted
+    const ConversionResult& getConversionResult() const { return conversion; }
+
+    // memory used by the values set (not the default ones)
+    virtual size_t getValueBytes() const { return 0; }
+
+    // the environment variable read when the option is not in the
+    // command line, it must be set before adding the option to the
+    // parser (see also Parser::bindEnvironment)
+    BaseOption& setEnvironmentVariable(const std::string& name) {
+        environmentVariable = StringPool::shared().intern(name);
+        return *this;
+    }
+
+    std::string      getEnvironmentVariable()     const { return std::string(environmentVariable); }
+    std::string_view getEnvironmentVariableView() const { return environmentVariable; }
+
+    // lazy options only check the values while parsing (see checkValue),
+    // they keep the raw text and convert it the first time the value is
+    // read. The text is argv (or a response/config file of the parser),
+    // so the values must be read while the parser exists
+    BaseOption& convertLazily(bool convertLazy = true) {
+        lazy = convertLazy;
+        return *this;
+    }
+
+    bool isLazy() const { return lazy; }
+
+    // a list that allows it takes "@path" as a file of values, one per
+    // line (empty lines are skipped). The file is mapped and each line
+    // is given to the list as it is in the mapping (see addLine). Then
+    // a value starting with '@' is written "@@..." ("@@x" is "@x").
+    // Only the options that take lines can (Parser::addOption throws
+    // std::invalid_argument for the rest)
+    BaseOption& allowValueFiles(bool allow = true) {
+        valueFiles = allow;
+        return *this;
+    }
+
+    bool acceptsValueFiles() const { return valueFiles; }
+
+    // the huge values of a list of numbers (and the values of a lazy
+    // list, when there are many of them) are converted by up to
+    // "threads" threads, 0 to use all the cores (see appendNumbersInParallel).
+    // The conversions of the list must be thread safe
+    BaseOption& convertInParallel(unsigned threads = 0) {
+        parallelism = threads;
+        return *this;
+    }
+
+    unsigned getParallelism() const { return parallelism; }
+
+    // converts the values kept by a lazy option (if any)
+    virtual void convertPending() {}
+
+    // the same as setValue(), but the value is stored in a value
+    // created by newValue(), so the option itself doesn't change.
+    // This is what a ParseResult uses.
+    virtual OptionValue* newValue() const { return new OptionValue(); }
+
+    virtual ConversionResult storeValue(OptionValue& stored, const char* readValue) const {
+        // the options that don't know how to do it
+        return ConversionResult(CONVERSION_INVALID);
+    }
+
+    // the same as setValue() and storeValue(), for a line of a value
+    // file: it's not null terminated. Only the lists take them
+    virtual bool takesLines() const { return false; }
+
+    virtual ConversionResult addLine(std::string_view line) {
+        return ConversionResult(CONVERSION_INVALID);
+    }
+
+    virtual ConversionResult storeLine(OptionValue& stored, std::string_view line) const {
+        return ConversionResult(CONVERSION_INVALID);
+    }
+
+    protected:
+    // configuration
+    char    shortOption;
+    std::string_view  longOption;
+    bool    mandatory;
+    bool    followsArgument;
+    std::string_view  description;
+    std::string_view  environmentVariable;
+    bool    lazy;
+    bool    valueFiles = false;
+    unsigned parallelism = 1;   // 1: no threads
+
+    // status & value
+    bool    found; // was it found?
+    ConversionResult conversion;
+
+};
+
+
+template<typename TYPE>
+class Option : public BaseOption {
+
+    public:
+    Option(char sOption, const char* lOption, bool mandatory, const char* descr = "")
+     : BaseOption(sOption, lOption, mandatory, needsArgument<TYPE>(), descr)
+    {}
+
+    Option(char sOption, const char* lOption, bool mandatory, const TYPE& defValue, const char* descr = "")
+     : BaseOption(sOption, lOption, mandatory, needsArgument<TYPE>(), descr), defaultValue(defValue)
+    {}
+
+    Option(const OptionSpec& spec, const TYPE& defValue = TYPE())
+     : BaseOption(spec, needsArgument<TYPE>()), defaultValue(defValue)
+    {}
+
+    // implement according the Option type...
+    // only the dev can know how to convert from a std::string
+    // to a TYPE type
+    // The developer can provide some specialization of the
+    // canBeConvertedTo and fromString functions, or he can
+    // completely override the setValue method
+    virtual void setValue(const char* readValue) {
+
+        size_t length = strlen(readValue);
+
+        if ( lazy ) {
+
+            conversion = checkValue<TYPE>( readValue, length );
+
+            if ( conversion.ok() ) {
+                pendingValue = readValue;
+                markAsFound();
+            }
+
+            return;
+        }
+
+        conversion = Converter<TYPE>::convert( readValue, length, value );
+
+        if ( conversion.ok() ) {
+            pendingValue = NULL;
+            markAsFound();
+        }
+    }
+
+    TYPE getValue() {
+
+        if ( ! found )
+            return defaultValue;
+
+        convertPending();
+
+        return value;
+
+    }
+
+    virtual void convertPending() {
+
+        if ( pendingValue != NULL ) {
+            Converter<TYPE>::convert( pendingValue, strlen(pendingValue), value );
+            pendingValue = NULL;
+        }
+    }
+
+    virtual void reset() {
+        BaseOption::reset();
+        pendingValue = NULL;
+    }
+
+    virtual size_t getValueBytes() const {
+        return found ? sizeof(TYPE) + heapBytes(value) : 0;
+    }
+
+    typedef TYPE ValueType;
+
+    const TYPE& getDefaultValue() const { return defaultValue; }
+
+    virtual OptionValue* newValue() const {
+        return new StoredValue<TYPE>();
+    }
+
+    virtual ConversionResult storeValue(OptionValue& stored, const char* readValue) const {
+        return Converter<TYPE>::convert( readValue, strlen(readValue), static_cast< StoredValue<TYPE>& >(stored).value );
+    }
+
+
+    protected:
+    // configuration
+    TYPE    value;
+    TYPE    defaultValue;
+
+    // the text of the value, when it's not converted yet
+    const char* pendingValue = NULL;
+};
+
+// a read only view of contiguous values, as the ones
+// stored by the list options
+template<typename TYPE>
+class ValueSpan {
+
+    public:
+
+    typedef const TYPE* iterator;
+
+    ValueSpan() : first(NULL), count(0) {}
+    ValueSpan(const TYPE* data, size_t size) : first(data), count(size) {}
+
+    iterator begin() const { return first; }
+    iterator end()   const { return first + count; }
+
+    size_t size()  const { return count; }
+    bool   empty() const { return count == 0; }
+
+    const TYPE& operator[](size_t index) const { return first[index]; }
+    const TYPE& front() const { return first[0]; }
+    const TYPE& back()  const { return first[count-1]; }
+
+    private:
+
+    const TYPE* first;
+    size_t      count;
+};
+
+// how the list options add a value to the list (the lists
+// of numbers can use "threads" threads, see convertInParallel)
+template<typename TYPE>
+ConversionResult appendListValue(std::vector<TYPE>& values, const char* text, size_t length, unsigned threads = 1) {
+
+    if constexpr ( IsNumberList<TYPE>::value ) {
+
+        if ( threads != 1 )
+            return appendNumbersInParallel( values, text, length, threads );
+
+        return appendNumbers( values, text, length );
+    }
+
+    TYPE converted;
+
+    ConversionResult result = Converter<TYPE>::convert( text, length, converted );
+
+    if ( result.ok() )
+        values.push_back( std::move(converted) );
+
+    return result;
+}
+
+template<typename TYPE>
+class ListOption : public BaseOption {
+
+    public:
+    ListOption(char sOption, const char* lOption, bool mandatory, const char* descr = "")
+     : BaseOption(sOption, lOption, mandatory, true, descr)
+    {}
+
+    ListOption(char sOption, const char* lOption, bool mandatory, const std::list<TYPE>& defValue, const char* descr = "")
+     : BaseOption(sOption, lOption, mandatory, true, descr), defaultValue(defValue.begin(), defValue.end())
+    {}
+
+    ListOption(char sOption, const char* lOption, bool mandatory, const std::vector<TYPE>& defValue, const char* descr = "")
+     : BaseOption(sOption, lOption, mandatory, true, descr), defaultValue(defValue)
+    {}
+
+    ListOption(const OptionSpec& spec, const std::vector<TYPE>& defValue = std::vector<TYPE>())
+     : BaseOption(spec, true), defaultValue(defValue)
+    {}
+
+    // implement according the Option type...
+    // only the dev can know how to convert from a std::string
+    // to a TYPE type
+    // The developer can provide some specialization of the
+    // canBeConvertedTo and fromString functions, or he can
+    // completely override the setValue method
+    virtual void setValue(const char* readValue) {
+
+        addLine( std::string_view(readValue, strlen(readValue)) );
+    }
+
+    virtual bool takesLines() const { return true; }
+
+    virtual ConversionResult addLine(std::string_view line) {
+
+        if ( lazy ) {
+
+            conversion = checkText( line.data(), line.size() );
+
+            if ( conversion.ok() ) {
+                pendingValues.push_back(line);
+                pending.store(true, std::memory_order_relaxed);
+                markAsFound();
+            }
+
+            return conversion;
+        }
+
+        // the values must keep their order
+        convertPendingValues();
+
+        conversion = appendValue( value, line.data(), line.size() );
+
+        if ( conversion.ok() )
+            markAsFound();
+
+        return conversion;
+    }
+
+    // a copy of the values, prefer getValues() or getSpan()
+    // as they don't copy anything
+    std::list<TYPE> getValue() {
+
+        const std::vector<TYPE>& values = getValues();
+
+        return std::list<TYPE>(values.begin(), values.end());
+
+    }
+
+    // the first read converts the values of a lazy list, but
+    // it's still safe to read them from several threads at once
+    const std::vector<TYPE>& getValues() const {
+
+        if ( ! found )
+            return defaultValue;
+
+        convertPendingValues();
+
+        return value;
+
+    }
+
+    ValueSpan<TYPE> getSpan() const {
+
+        const std::vector<TYPE>& values = getValues();
+
+        return ValueSpan<TYPE>(values.data(), values.size());
+
+    }
+
+    virtual void reset() {
+        BaseOption::reset();
+
+        // keep the memory, it'll probably be needed again
+        value.clear();
+        pendingValues.clear();
+        pending.store(false, std::memory_order_relaxed);
+    }
+
+    virtual void convertPending() {
+        convertPendingValues();
+    }
+
+    virtual size_t getValueBytes() const {
+        return heapBytes(value) + pendingValues.capacity() * sizeof(std::string_view);
+    }
+
+    typedef std::vector<TYPE> ValueType;
+
+    const std::vector<TYPE>& getDefaultValue() const { return defaultValue; }
+
+    virtual OptionValue* newValue() const {
+        return new StoredValue< std::vector<TYPE> >();
+    }
+
+    virtual ConversionResult storeValue(OptionValue& stored, const char* readValue) const {
+        return appendValue( static_cast< StoredValue< std::vector<TYPE> >& >(stored).value, readValue, strlen(readValue) );
+    }
+
+    virtual ConversionResult storeLine(OptionValue& stored, std::string_view line) const {
+        return appendValue( static_cast< StoredValue< std::vector<TYPE> >& >(stored).value, line.data(), line.size() );
+    }
+
+
+    protected:
+    // configuration
+    mutable std::vector<TYPE> value;
+    std::vector<TYPE> defaultValue;
+
+    // the texts of the values not converted yet (they're converted
+    // on the first read, so the read methods are still const)
+    mutable std::vector<std::string_view> pendingValues;
+
+    // the readers of a shared list only take the lock while
+    // there's something to convert (the first time)
+    mutable std::atomic<bool> pending{false};
+    mutable std::mutex conversionMutex;
+
+    static ConversionResult checkText(const char* text, size_t length) {
+
+        if constexpr ( IsNumberList<TYPE>::value )
+            return checkNumbers<TYPE>( text, length );
+
+        return checkValue<TYPE>( text, length );
+    }
+
+    void convertPendingValues() const {
+
+        if ( ! pending.load(std::memory_order_acquire) )
+            return;
+
+        std::lock_guard<std::mutex> lock(conversionMutex);
+
+        // another reader could have converted them meanwhile
+        if ( pendingValues.empty() )
+            return;
+
+        size_t pieces = 1;
+
+        if ( parallelism != 1 ) {
+            size_t threads = parallelism ? parallelism : ConversionPool::defaultThreads();
+            pieces = std::min(threads, pendingValues.size() / PARALLEL_MIN_VALUES);
+        }
+
+        if ( pieces <= 1 ) {
+
+            value.reserve( value.size() + pendingValues.size() );
+
+            for(size_t index=0; index < pendingValues.size(); ++index)
+                appendValue( value, pendingValues[index].data(), pendingValues[index].size() );
+        }
+        else {
+
+            // (they were checked, so there are no errors to report)
+            std::vector< std::vector<TYPE> > converted(pieces);
+
+            ConversionPool::shared().run(pieces, [&](size_t piece) {
+
+                size_t begin = piece * pendingValues.size() / pieces;
+                size_t end   = (piece + 1) * pendingValues.size() / pieces;
+
+                converted[piece].reserve(end - begin);
+
+                for(size_t index=begin; index < end; ++index)
+                    appendListValue( converted[piece], pendingValues[index].data(), pendingValues[index].size() );
+            });
+
+            size_t total = 0;
+
+            for(size_t piece=0; piece < pieces; ++piece)
+                total += converted[piece].size();
+
+            value.reserve( value.size() + total );
+
+            for(size_t piece=0; piece < pieces; ++piece)
+                value.insert( value.end(), std::make_move_iterator(converted[piece].begin()), std::make_move_iterator(converted[piece].end()) );
+        }
+
+        pendingValues.clear();
+        pending.store(false, std::memory_order_release);
+    }
+
+    // converts and adds one more value to the list (or
+    // several ones, for the lists of numbers)
+    ConversionResult appendValue(std::vector<TYPE>& values, const char* text, size_t length) const {
+        return appendListValue( values, text, length, parallelism );
+    }
+};
+
+class BoolOption : public Option<bool> {
+
+    public:
+
+    BoolOption(const OptionSpec& spec)
+     : Option<bool>(spec, false)
+    {}
+
+    BoolOption(char sOption, const char* lOption, bool mandatory, const char* descr = "")
+     : Option<bool>(sOption, lOption, mandatory, false, descr)
+    {}
+
+    bool getValue() {
+        return found;
+    }
+
+    // flags have no value to read, once found they're true
+    virtual OptionValue* newValue() const {
+        return new StoredValue<bool>(true);
+    }
+
+};
+
+
+typedef Option<std::string>     StringOption;
+typedef Option<int>             IntegerOption;
+typedef Option<float>           FloatOption;
+typedef Option<double>          DoubleOption;
+
+typedef ListOption<std::string> StringListOption;
+typedef ListOption<std::string_view> StringViewListOption;
+typedef ListOption<int>         IntegerListOption;
+typedef ListOption<float>       FloatListOption;
+typedef ListOption<double>      DoubleListOption;
+
+
+template<typename T>
+class RangeNumberOption : public ListOption<T> {
+
+    public:
+
+    RangeNumberOption(char sOption, const char* lOption, bool mandatory, const char* descr = "")
+     : ListOption<T>(sOption, lOption, mandatory, descr)
+    {}
+
+    RangeNumberOption(char sOption, const char* lOption, bool mandatory, const std::list<T>& defaultValue, const char* descr = "")
+     : ListOption<T>(sOption, lOption, mandatory, defaultValue, descr)
+    {}
+
+    RangeNumberOption(char sOption, const char* lOption, bool mandatory, const std::vector<T>& defaultValue, const char* descr = "")
+     : ListOption<T>(sOption, lOption, mandatory, defaultValue, descr)
+    {}
+
+    RangeNumberOption(const OptionSpec& spec, const std::vector<T>& defaultValue = std::vector<T>())
+     : ListOption<T>(spec, defaultValue)
+    {}
+
+    // the limits of the range (the first and the last values, if it
+    // was specified more than once). There is no range when it wasn't
+    // given and it has no default value, they're T() then
+    T getBegin() const {
+        const std::vector<T>& values = ListOption<T>::getValues();
+        return values.empty() ? T() : values.front();
+    }
+
+    T getEnd() const {
+        const std::vector<T>& values = ListOption<T>::getValues();
+        return values.empty() ? T() : values.back();
+    }
+
+    // (a line would be added as a list, not as a range)
+    virtual bool takesLines() const { return false; }
+
+    void setValue(const char* readValue) {
+
+        this->conversion = appendRange( this->value, readValue );
+
+        if ( this->conversion.ok() )
+            this->markAsFound();
+
+    }
+
+    virtual ConversionResult storeValue(OptionValue& stored, const char* readValue) const {
+        return appendRange( static_cast< StoredValue< std::vector<T> >& >(stored).value, readValue );
+    }
+
+    private:
+
+    // "begin,end": both limits are added to the list
+    static ConversionResult appendRange(std::vector<T>& values, const char* readValue) {
+
+        size_t length = strlen(readValue);
+        size_t pos = findChar(readValue, length, ',');
+
+        // if there is no end some error occur in the params
+        if ( pos == length || pos + 1 == length )
+            return ConversionResult(CONVERSION_INVALID, length);
+
+        // and only one end
+        size_t extra = pos + 1 + findChar(readValue + pos + 1, length - pos - 1, ',');
+
+        if ( extra != length )
+            return ConversionResult(CONVERSION_TRAILING, extra);
+
+        return appendNumbers( values, readValue, length );
+    }
+
+};
+
+typedef RangeNumberOption<int>   IntegerRange;
+typedef RangeNumberOption<float> FloatRange;
+typedef RangeNumberOption<long>  LongRange;
+
+
+/*
+ * Sets of ranges
+ *
+ * A RangeNumberOption takes one range, a RangeSetOption takes many
+ * ranges and single values ("1-1024,8000-9000,30000-65535,80") and
+ * keeps them as an IntervalSet: sorted, merged (the ones that overlap
+ * or touch each other become one) and in two arrays, the begins and
+ * the ends, so contains() is a binary search over contiguous memory:
+ *
+ *      IntegerRangeSet ports('P', "ports", false, "allowed ports");
+ *      ...
+ *      if ( ports.contains(packet.port) )
+ *          ...
+ */
+
+template<typename T>
+class IntervalSet {
+
+    public:
+
+    // the number of (merged) intervals
+    size_t size()  const { return begins.size(); }
+    bool   empty() const { return begins.empty(); }
+
+    T getBegin(size_t index) const { return begins[index]; }
+    T getEnd(size_t index)   const { return ends[index];   }
+
+    void clear() {
+        begins.clear();
+        ends.clear();
+    }
+
+    void add(T begin, T end) {
+        begins.push_back(begin);
+        ends.push_back(end);
+        normalize();
+    }
+
+    // adds "begin-end" and single values, separated by commas.
+    // If any of them is wrong, none of them is added
+    ConversionResult add(const char* text, size_t length);
+
+    bool contains(T value) const {
+
+        size_t count = begins.size();
+
+        if ( count == 0 || value < begins[0] )
+            return false;
+
+        // the last interval beginning before the value,
+        // with no branches to mispredict
+        const T* base = begins.data();
+
+        while ( count > 1 ) {
+            size_t half = count / 2;
+            base   = ( base[half] <= value ) ? base + half : base;
+            count -= half;
+        }
+
+        return value <= ends[ base - begins.data() ];
+    }
+
+    size_t getHeapBytes() const {
+        return ( begins.capacity() + ends.capacity() ) * sizeof(T);
+    }
+
+    private:
+
+    std::vector<T> begins;
+    std::vector<T> ends;
+
+    void normalize();
+};
+
+template<typename T>
+ConversionResult
+IntervalSet<T>::add(const char* text, size_t length) {
+
+    size_t previousSize = begins.size();
+    size_t begin = 0;
+
+    while ( true ) {
+
+        size_t end = begin + findChar(text + begin, length - begin, ',');
+
+        // the '-' of a negative begin is not the separator
+        size_t separator = ( end > begin + 1 ) ? begin + 1 + findChar(text + begin + 1, end - begin - 1, '-') : end;
+
+        T first;
+        T last;
+
+        // where the value being converted starts
+        size_t offset = begin;
+
+        ConversionResult result = Converter<T>::convert( text + begin, separator - begin, first );
+
+        if ( result.ok() ) {
+
+            if ( separator == end )
+                last = first;
+            else {
+                offset = separator + 1;
+                result = Converter<T>::convert( text + offset, end - offset, last );
+
+                // the end can't be lower than the begin
+                if ( result.ok() && last < first )
+                    result = ConversionResult(CONVERSION_INVALID);
+            }
+        }
+
+        if ( ! result.ok() ) {
+            begins.resize(previousSize);
+            ends.resize(previousSize);
+            result.position += offset;
+            return result;
+        }
+
+        begins.push_back(first);
+        ends.push_back(last);
+
+        if ( end == length )
+            break;
+
+        begin = end + 1;
+    }
+
+    normalize();
+
+    return ConversionResult();
+}
+
+template<typename T>
+void
+IntervalSet<T>::normalize() {
+
+    size_t count = begins.size();
+
+    bool sorted = true;
+
+    for(size_t index=1; sorted && index < count; ++index)
+        sorted = ( begins[index - 1] <= begins[index] );
+
+    if ( ! sorted ) {
+
+        std::vector< std::pair<T, T> > intervals(count);
+
+        for(size_t index=0; index < count; ++index)
+            intervals[index] = std::make_pair(begins[index], ends[index]);
+
+        std::sort(intervals.begin(), intervals.end());
+
+        for(size_t index=0; index < count; ++index) {
+            begins[index] = intervals[index].first;
+            ends[index]   = intervals[index].second;
+        }
+    }
+
+    size_t merged = 0;
+
+    for(size_t index=1; index < count; ++index) {
+
+        T& last = ends[merged];
+
+        // overlapping or touching (for integers, 1-5 and 6-9 are 1-9)
+        bool joins = ( begins[index] <= last ) ||
+                     ( std::is_integral<T>::value && last < std::numeric_limits<T>::max() && begins[index] == last + 1 );
+
+        if ( joins ) {
+            if ( ends[index] > last )
+                last = ends[index];
+        }
+        else {
+            ++merged;
+            begins[merged] = begins[index];
+            ends[merged]   = ends[index];
+        }
+    }
+
+    if ( count > 0 ) {
+        begins.resize(merged + 1);
+        ends.resize(merged + 1);
+    }
+}
+
+template<typename T>
+inline size_t heapBytes(const IntervalSet<T>& values) {
+    return values.getHeapBytes();
+}
+
+template<typename T>
+class RangeSetOption : public BaseOption {
+
+    public:
+
+    RangeSetOption(char sOption, const char* lOption, bool mandatory, const char* descr = "")
+     : BaseOption(sOption, lOption, mandatory, true, descr)
+    {}
+
+    RangeSetOption(char sOption, const char* lOption, bool mandatory, const IntervalSet<T>& defValue, const char* descr = "")
+     : BaseOption(sOption, lOption, mandatory, true, descr), defaultValue(defValue)
+    {}
+
+    RangeSetOption(const OptionSpec& spec, const IntervalSet<T>& defValue = IntervalSet<T>())
+     : BaseOption(spec, true), defaultValue(defValue)
+    {}
+
+    // the ranges are added to the ones given before
+    virtual void setValue(const char* readValue) {
+        addLine( std::string_view(readValue, strlen(readValue)) );
+    }
+
+    virtual bool takesLines() const { return true; }
+
+    virtual ConversionResult addLine(std::string_view line) {
+
+        conversion = value.add( line.data(), line.size() );
+
+        if ( conversion.ok() )
+            markAsFound();
+
+        return conversion;
+    }
+
+    const IntervalSet<T>& getValue() const {
+
+        if ( ! found )
+            return defaultValue;
+        else
+            return value;
+
+    }
+
+    bool contains(T number) const {
+        return getValue().contains(number);
+    }
+
+    virtual void reset() {
+        BaseOption::reset();
+        value.clear();
+    }
+
+    virtual size_t getValueBytes() const {
+        return heapBytes(value);
+    }
+
+    typedef IntervalSet<T> ValueType;
+
+    const IntervalSet<T>& getDefaultValue() const { return defaultValue; }
+
+    virtual OptionValue* newValue() const {
+        return new StoredValue< IntervalSet<T> >();
+    }
+
+    virtual ConversionResult storeValue(OptionValue& stored, const char* readValue) const {
+        return static_cast< StoredValue< IntervalSet<T> >& >(stored).value.add( readValue, strlen(readValue) );
+    }
+
+    virtual ConversionResult storeLine(OptionValue& stored, std::string_view line) const {
+        return static_cast< StoredValue< IntervalSet<T> >& >(stored).value.add( line.data(), line.size() );
+    }
+
+    protected:
+    // configuration
+    IntervalSet<T> value;
+    IntervalSet<T> defaultValue;
+};
+
+typedef RangeSetOption<int>   IntegerRangeSet;
+typedef RangeSetOption<long>  LongRangeSet;
+
+
+inline constexpr unsigned int foldedHash(const char* text, size_t length, unsigned int seed) {
+
+    // FNV-1a over the folded chars plus a final mix,
+    // so the low bits depend on the whole name
+    unsigned int hash = 2166136261u ^ (seed * 0x9e3779b9u);
+
+    for(size_t index=0; index < length; ++index)
+        hash = (hash ^ (unsigned char) foldChar(text[index])) * 16777619u;
+
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+
+    return hash;
+}
+
+
+// hash and comparison ignoring the case,
+// to index the long options names as they are
+struct FoldedHash {
+    size_t operator()(std::string_view name) const {
+        return foldedHash(name.data(), name.size(), 0);
+    }
+};
+
+struct FoldedEqual {
+    bool operator()(std::string_view a, std::string_view b) const {
+
+        return a.size() == b.size() && foldedPrefixLength(a.data(), b.data(), a.size()) == a.size();
+    }
+};
+
+
+/*
+ * Prefix tree with the (folded) long options, used to resolve
+ * abbreviations in O(length of the argument) instead of asking
+ * every option for its BaseOption::bestMatch.
+ *
+ * The result is the same one the linear search gave: the winner
+ * is the option sharing the longest prefix with the argument (and
+ * not being shorter than it), and if more than one option shares
+ * that prefix the argument is ambiguous.
+ */
+class OptionTrie {
+
+    public:
+
+    OptionTrie() {
+        nodes.push_back(Node(0, -1));
+    }
+
+    // options are identified by its position in the parser
+    void insert(const std::string& foldedName, int option);
+
+    // returns the best matching option, or -1 if none (or more than one)
+    // matches. In the ambiguous case all the candidates are stored in
+    // "ambiguous", sorted as they were registered
+    int resolve(const char* name, size_t length, std::vector<int>& ambiguous) const;
+
+    // all the options starting with "prefix", sorted as they were registered
+    void complete(const char* prefix, size_t length, std::vector<int>& found) const;
+
+    private:
+
+    struct Entry {
+        Entry(int opt, size_t len) : option(opt), length(len) {}
+
+        static bool byOrder(const Entry& a, const Entry& b) {
+            return a.option < b.option;
+        }
+
+        int         option;
+        size_t      length;
+    };
+
+    struct Node {
+        Node(char lbl, int prnt)
+         : label(lbl), parent(prnt), firstChild(-1), nextSibling(-1),
+           longest(-1), longestLength(0), secondLength(0)
+        {}
+
+        char        label;
+        int         parent;
+        int         firstChild;
+        int         nextSibling;
+
+        // the two longest names below this node, this is all we
+        // need to know if an abbreviation is unique
+        int         longest;
+        size_t      longestLength;
+        size_t      secondLength;
+
+        // options whose long name ends exactly here
+        std::vector<Entry> entries;
+    };
+
+    std::vector<Node> nodes;
+
+    int findChild(int node, char label) const {
+        for(int child = nodes[node].firstChild; child != -1; child = nodes[child].nextSibling) {
+            if ( nodes[child].label == label )
+                return child;
+        }
+        return -1;
+    }
+
+    void collect(int node, size_t minLength, std::vector<Entry>& found) const;
+
+};
+
+void
+OptionTrie::insert(const std::string& foldedName, int option) {
+
+    int node = 0;
+
+    for(size_t index=0; index < foldedName.size(); ++index) {
+
+        int child = findChild(node, foldedName[index]);
+
+        if ( child == -1 ) {
+            child = nodes.size();
+            nodes.push_back(Node(foldedName[index], node));
+            nodes[child].nextSibling = nodes[node].firstChild;
+            nodes[node].firstChild   = child;
+        }
+
+        node = child;
+
+        // update the longest names below this prefix
+        Node& current = nodes[node];
+        size_t length = foldedName.size();
+
+        if ( length > current.longestLength ) {
+            current.secondLength  = current.longestLength;
+            current.longestLength = length;
+            current.longest       = option;
+        }
+        else if ( length > current.secondLength ) {
+            current.secondLength  = length;
+        }
+    }
+
+    nodes[node].entries.push_back(Entry(option, foldedName.size()));
+}
+
+int
+OptionTrie::resolve(const char* name, size_t length, std::vector<int>& ambiguous) const {
+
+    // go down as far as the argument lets us
+    int node = 0;
+
+    for(size_t index=0; index < length; ++index) {
+
+        int child = findChild(node, foldChar(name[index]));
+
+        if ( child == -1 )
+            break;
+
+        node = child;
+    }
+
+    // and now back up to the deepest prefix having some option
+    // that is not shorter than the argument
+    while ( node != 0 && nodes[node].longestLength < length )
+        node = nodes[node].parent;
+
+    if ( node == 0 )
+        return -1;
+
+    // only one candidate, we have a winner
+    if ( nodes[node].secondLength < length )
+        return nodes[node].longest;
+
+    // this is conflicting with other options, let's report all of them
+    std::vector<Entry> found;
+    collect(node, length, found);
+
+    // keep the same order they were added to the parser
+    std::sort(found.begin(), found.end(), Entry::byOrder);
+
+    for(size_t index=0; index < found.size(); ++index)
+        ambiguous.push_back(found[index].option);
+
+    return -1;
+}
+
+void
+OptionTrie::complete(const char* prefix, size_t length, std::vector<int>& found) const {
+
+    int node = 0;
+
+    for(size_t index=0; index < length && node != -1; ++index)
+        node = findChild(node, foldChar(prefix[index]));
+
+    if ( node == -1 )
+        return;
+
+    std::vector<Entry> entries;
+    collect(node, 0, entries);
+
+    std::sort(entries.begin(), entries.end(), Entry::byOrder);
+
+    for(size_t index=0; index < entries.size(); ++index)
+        found.push_back(entries[index].option);
+}
+
+void
+OptionTrie::collect(int node, size_t minLength, std::vector<Entry>& found) const {
+
+    const std::vector<Entry>& entries = nodes[node].entries;
+
+    for(size_t index=0; index < entries.size(); ++index) {
+        if ( entries[index].length >= minLength )
+            found.push_back(entries[index]);
+    }
+
+    for(int child = nodes[node].firstChild; child != -1; child = nodes[child].nextSibling)
+        collect(child, minLength, found);
+}
+
+
+/*
+ * Edit distances
+ *
+ * An unknown option is answered with the long options closest to it
+ * ("did you mean '--port'?"), by edit distance: the chars inserted,
+ * removed or replaced to go from one name to the other (ignoring the
+ * case). It's computed with Myers' bit-parallel algorithm: the name
+ * typed (the pattern, up to 64 chars) is kept as a bit mask per char,
+ * and each char of an option updates a whole column of the distance
+ * matrix with a few word operations (thousands of options are compared
+ * in a fraction of a millisecond).
+ */
+
+class EditDistance {
+
+    public:
+
+    enum { MAX_LENGTH = 64 };
+
+    EditDistance(std::string_view text);
+
+    // false if the pattern is too long to be compared
+    bool isValid() const { return length <= MAX_LENGTH; }
+
+    size_t getLength() const { return length; }
+
+    // from the pattern to "text", when it's bigger than "limit"
+    // the search can stop (and something bigger is returned)
+    size_t to(std::string_view text, size_t limit = ~size_t(0)) const;
+
+    private:
+
+    // the positions of each char in the pattern
+    // (both cases of a letter have the same ones)
+    uint64_t    positions[256];
+    size_t      length;
+};
+
+EditDistance::EditDistance(std::string_view text) : length(text.size()) {
+
+    memset(positions, 0, sizeof(positions));
+
+    if ( ! isValid() )
+        return;
+
+    for(size_t index=0; index < length; ++index) {
+
+        unsigned char c = foldChar(text[index]);
+
+        positions[c] |= uint64_t(1) << index;
+
+        if ( c >= 'a' && c <= 'z' )
+            positions[c - 'a' + 'A'] |= uint64_t(1) << index;
+    }
+}
+
+size_t
+EditDistance::to(std::string_view text, size_t limit) const {
+
+    if ( length == 0 )
+        return text.size();
+
+    // the vertical deltas of the current column (+1 or -1 for
+    // each row), the first column goes from 0 to length
+    uint64_t plus  = ~uint64_t(0);
+    uint64_t minus = 0;
+    uint64_t last  = uint64_t(1) << (length - 1);
+
+    size_t distance = length;
+
+    for(size_t index=0; index < text.size(); ++index) {
+
+        uint64_t equal = positions[ (unsigned char) text[index] ];
+
+        uint64_t vertical   = equal | minus;
+        uint64_t horizontal = ( ( (equal & plus) + plus ) ^ plus ) | equal;
+
+        uint64_t horizontalPlus  = minus | ~(horizontal | plus);
+        uint64_t horizontalMinus = plus & horizontal;
+
+        // the last row is the distance so far
+        if ( horizontalPlus & last )
+            ++distance;
+        else if ( horizontalMinus & last )
+            --distance;
+
+        // (the first row goes from 0 to the text size)
+        horizontalPlus  = (horizontalPlus << 1) | 1;
+        horizontalMinus = horizontalMinus << 1;
+
+        plus  = horizontalMinus | ~(vertical | horizontalPlus);
+        minus = horizontalPlus & vertical;
+
+        // each char left can lower it by one at most
+        if ( distance > limit && distance - limit > text.size() - index - 1 )
+            return distance;
+    }
+
+    return distance;
+}
+
+// keeps the closest names to a pattern, the ones with
+// the smallest distance (if it's not bigger than a limit)
+class Suggestions {
+
+    public:
+
+    Suggestions(std::string_view text, size_t maxDistance)
+     : distance(text), best(maxDistance)
+    {}
+
+    void add(std::string_view name) {
+
+        if ( ! distance.isValid() || name.empty() )
+            return;
+
+        // it's at least the difference of the lengths
+        size_t difference = ( name.size() > distance.getLength() ) ? name.size() - distance.getLength()
+                                                                   : distance.getLength() - name.size();
+        if ( difference > best )
+            return;
+
+        size_t nameDistance = distance.to(name, best);
+
+        if ( nameDistance < best ) {
+            best = nameDistance;
+            names.clear();
+        }
+
+        if ( nameDistance == best )
+            names.push_back(name);
+    }
+
+    const std::vector<std::string_view>& getNames() const { return names; }
+
+    // a typo every three chars (but at least one) can be fixed
+    static size_t defaultDistance(std::string_view text) {
+        return std::max<size_t>(1, text.size() / 3);
+    }
+
+    private:
+
+    EditDistance distance;
+    size_t       best;
+
+    std::vector<std::string_view> names;
+};
+
+
+/*
+ * Compile time schemas
+ *
+ * When the set of options is fixed at build time, the lookup tables
+ * can be computed by the compiler instead of by addOption(): a perfect
+ * hash of the (folded) long options for exact matches, a prefix tree
+ * for the abbreviations and a direct table for the short options.
+ * There is no setup at all at startup, and no heap allocation.
+ *
+ *      constexpr OptionSpec serverSpecs[] = {
+ *          { 'd', "debug",       false, "enables the debug mode" },
+ *          { 'p', "port",        false, "server port" },
+ *          { 'n', "portability" },
+ *      };
+ *
+ *      constexpr auto serverSchema = STATIC_SCHEMA(serverSpecs);
+ *
+ *      static_assert( serverSchema.findOption("port", 4) == 1, "..." );
+ *
+ * The help option is always appended to the schema (its index is the
+ * number of specs), and duplicated options are reported at compile time.
+ *
+ * To parse with it, give the schema to the Parser along with the options
+ * (in the same order as the specs):
+ *
+ *      BaseOption* serverOptions[] = { &debug, &port, &portability };
+ *
+ *      Parser parser(serverSchema, serverOptions);
+ *
+ * The options can be built from the specs as well (the rest of the spec
+ * is the mandatory flag and the description). They point to the texts
+ * of the spec instead of keeping a copy (see StringPool), so neither the
+ * schema nor the options allocate anything for its names:
+ *
+ *      BoolOption    debug(serverSpecs[0]);
+ *      IntegerOption port(serverSpecs[1], 23);
+ */
+
+struct OptionSpec {
+    char        shortOption;
+    const char* longOption;
+    bool        mandatory;
+    const char* description;
+};
+
+// the option every parser has (the schemas too)
+inline constexpr OptionSpec helpOptionSpec = { 'h', "help", false, "print this help" };
+
+inline
+BaseOption::BaseOption(const OptionSpec& spec, bool fArgument)
+ : shortOption(spec.shortOption),
+   longOption(spec.longOption ? spec.longOption : ""),
+   mandatory(spec.mandatory), followsArgument(fArgument),
+   description(spec.description ? spec.description : ""),
+   lazy(false), found(false)
+{}
+
+struct SchemaLookup {
+    enum {
+        NOT_FOUND = -1,
+        AMBIGUOUS = -2
+    };
+};
+
+inline constexpr size_t schemaLength(const char* text) {
+    size_t length = 0;
+
+    while ( text[length] != '\0' )
+        ++length;
+
+    return length;
+}
+
+// size of the tables needed by a schema with "count" options
+inline constexpr size_t schemaTableSize(size_t count) {
+    size_t size = 1;
+
+    while ( size < 2 * count )
+        size *= 2;
+
+    return size;
+}
+
+template<size_t N>
+constexpr size_t schemaTrieNodes(const OptionSpec (&specs)[N]) {
+    // an upper bound: the root, the help option and every char
+    size_t nodes = 1 + 4;
+
+    for(size_t index=0; index < N; ++index)
+        nodes += schemaLength(specs[index].longOption);
+
+    return nodes;
+}
+
+template<size_t N, size_t NODES, size_t TABLE = schemaTableSize(N + 1)>
+class StaticSchema : public SchemaLookup {
+
+    public:
+
+    // the specs plus the help option
+    static constexpr size_t SIZE = N + 1;
+
+    constexpr explicit StaticSchema(const OptionSpec (&specs)[N])
+     : entries(), lengths(), shortIndex(), slots(), displacements(), nodes(), usedNodes(1)
+    {
+        for(size_t index=0; index < N; ++index)
+            entries[index] = specs[index];
+
+        entries[N] = helpOptionSpec;
+
+        for(size_t index=0; index < 256; ++index)
+            shortIndex[index] = NOT_FOUND;
+
+        for(size_t index=0; index < SIZE; ++index) {
+
+            lengths[index] = schemaLength(entries[index].longOption);
+
+            if ( entries[index].shortOption != 0 ) {
+
+                int& slot = shortIndex[ (unsigned char) entries[index].shortOption ];
+
+                if ( slot != NOT_FOUND )
+                    throw "duplicated short option in the schema";
+
+                slot = index;
+            }
+
+            if ( lengths[index] > 0 )
+                insert(index);
+        }
+
+        buildHash();
+    }
+
+    constexpr int findOption(char shortOption) const {
+        return shortIndex[ (unsigned char) shortOption ];
+    }
+
+    // returns the index of the option (exact or abbreviated match),
+    // NOT_FOUND or AMBIGUOUS
+    constexpr int findOption(const char* longOption, size_t length) const {
+
+        if ( length == 0 )
+            return NOT_FOUND;
+
+        // exact match
+        int displacement = displacements[ foldedHash(longOption, length, 0) & (TABLE - 1) ];
+
+        int slot = ( displacement < 0 ) ? -displacement - 1
+                                        : foldedHash(longOption, length, displacement) & (TABLE - 1);
+
+        int candidate = slots[slot];
+
+        if ( candidate != NOT_FOUND && equals(candidate, longOption, length) )
+            return candidate;
+
+        // abbreviations, see OptionTrie::resolve()
+        int node = 0;
+
+        for(size_t index=0; index < length; ++index) {
+
+            int child = findChild(node, foldChar(longOption[index]));
+
+            if ( child == -1 )
+                break;
+
+            node = child;
+        }
+
+        while ( node != 0 && nodes[node].longestLength < length )
+            node = nodes[node].parent;
+
+        if ( node == 0 )
+            return NOT_FOUND;
+
+        if ( nodes[node].secondLength >= length )
+            return AMBIGUOUS;
+
+        return nodes[node].longest;
+    }
+
+    constexpr size_t size() const { return SIZE; }
+
+    constexpr const OptionSpec& getSpec(size_t index) const { return entries[index]; }
+
+    private:
+
+    struct Node {
+        char    label           = 0;
+        int     parent          = -1;
+        int     firstChild      = -1;
+        int     nextSibling     = -1;
+        int     longest         = NOT_FOUND;
+        int     terminal        = NOT_FOUND;
+        size_t  longestLength   = 0;
+        size_t  secondLength    = 0;
+    };
+
+    OptionSpec  entries[SIZE];
+    size_t      lengths[SIZE];
+    int         shortIndex[256];
+
+    // perfect hash: the first hash picks a displacement, the displacement
+    // is either the slot itself (negative values) or the seed of a second hash
+    int         slots[TABLE];
+    int         displacements[TABLE];
+
+    Node        nodes[NODES];
+    size_t      usedNodes;
+
+    constexpr bool equals(int index, const char* longOption, size_t length) const {
+
+        if ( lengths[index] != length )
+            return false;
+
+        for(size_t pos=0; pos < length; ++pos) {
+            if ( foldChar(entries[index].longOption[pos]) != foldChar(longOption[pos]) )
+                return false;
+        }
+
+        return true;
+    }
+
+    constexpr int findChild(int node, char label) const {
+        for(int child = nodes[node].firstChild; child != -1; child = nodes[child].nextSibling) {
+            if ( nodes[child].label == label )
+                return child;
+        }
+        return -1;
+    }
+
+    constexpr void insert(size_t option) {
+
+        const char* name   = entries[option].longOption;
+        size_t      length = lengths[option];
+        int         node   = 0;
+
+        for(size_t index=0; index < length; ++index) {
+
+            int child = findChild(node, foldChar(name[index]));
+
+            if ( child == -1 ) {
+                child = usedNodes++;
+                nodes[child].label       = foldChar(name[index]);
+                nodes[child].parent      = node;
+                nodes[child].nextSibling = nodes[node].firstChild;
+                nodes[node].firstChild   = child;
+            }
+
+            node = child;
+
+            Node& current = nodes[node];
+
+            if ( length > current.longestLength ) {
+                current.secondLength  = current.longestLength;
+                current.longestLength = length;
+                current.longest       = option;
+            }
+            else if ( length > current.secondLength ) {
+                current.secondLength  = length;
+            }
+        }
+
+        if ( nodes[node].terminal != NOT_FOUND )
+            throw "duplicated long option in the schema";
+
+        nodes[node].terminal = option;
+    }
+
+    constexpr void buildHash() {
+
+        // group the options by its first hash (counting sort)
+        unsigned int firstHash[SIZE]      = {};
+        size_t       bucketStart[TABLE+1] = {};
+        size_t       members[SIZE]        = {};
+        size_t       filled[TABLE]        = {};
+        size_t       biggest              = 0;
+
+        for(size_t index=0; index < TABLE; ++index) {
+            slots[index]         = NOT_FOUND;
+            displacements[index] = 0;
+        }
+
+        for(size_t option=0; option < SIZE; ++option) {
+            if ( lengths[option] > 0 ) {
+                firstHash[option] = slotOf(option, 0);
+                bucketStart[ firstHash[option] + 1 ]++;
+            }
+        }
+
+        for(size_t bucket=0; bucket < TABLE; ++bucket) {
+            if ( bucketStart[bucket + 1] > biggest )
+                biggest = bucketStart[bucket + 1];
+
+            bucketStart[bucket + 1] += bucketStart[bucket];
+        }
+
+        for(size_t option=0; option < SIZE; ++option) {
+            if ( lengths[option] > 0 ) {
+                size_t bucket = firstHash[option];
+                members[ bucketStart[bucket] + filled[bucket]++ ] = option;
+            }
+        }
+
+        // place the crowded buckets first, looking for a seed
+        // that moves all their options to empty slots
+        for(size_t size = biggest; size > 1; --size) {
+            for(size_t bucket=0; bucket < TABLE; ++bucket) {
+
+                if ( filled[bucket] != size )
+                    continue;
+
+                const size_t* bucketMembers = members + bucketStart[bucket];
+
+                for(unsigned int seed=1; ; ++seed) {
+
+                    if ( seed > 1000000 )
+                        throw "unable to build the perfect hash of the schema";
+
+                    if ( place(bucketMembers, size, seed) ) {
+                        displacements[bucket] = seed;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // and the single ones go directly to any empty slot
+        size_t freeSlot = 0;
+
+        for(size_t bucket=0; bucket < TABLE; ++bucket) {
+
+            if ( filled[bucket] != 1 )
+                continue;
+
+            while ( slots[freeSlot] != NOT_FOUND )
+                ++freeSlot;
+
+            slots[freeSlot]       = members[ bucketStart[bucket] ];
+            displacements[bucket] = -(int) freeSlot - 1;
+        }
+    }
+
+    constexpr size_t slotOf(size_t option, unsigned int seed) const {
+        return foldedHash(entries[option].longOption, lengths[option], seed) & (TABLE - 1);
+    }
+
+    constexpr bool place(const size_t* bucketMembers, size_t size, unsigned int seed) {
+
+        for(size_t member=0; member < size; ++member) {
+
+            size_t slot = slotOf(bucketMembers[member], seed);
+
+            if ( slots[slot] != NOT_FOUND )
+                return false;
+
+            // two options of the same bucket can't share the slot
+            for(size_t other=0; other < member; ++other) {
+                if ( slotOf(bucketMembers[other], seed) == slot )
+                    return false;
+            }
+        }
+
+        for(size_t member=0; member < size; ++member)
+            slots[ slotOf(bucketMembers[member], seed) ] = bucketMembers[member];
+
+        return true;
+    }
+
+};
+
+#define STATIC_SCHEMA(specs) \
+    StaticSchema< sizeof(specs) / sizeof(specs[0]), schemaTrieNodes(specs) >(specs)
+
+
+/*
+ * A read only mapping of a whole file, or a private writable one (what
+ * is written on it, ie: null terminators, doesn't change the file, but
+ * each page written is copied).
+ */
+
+class MappedFile {
+
+    public:
+
+    MappedFile() : data(NULL), size(0) {}
+
+    ~MappedFile() {
+        if ( data != NULL )
+            munmap(data, size);
+    }
+
+    // false if it can't be mapped (see errno)
+    bool open(const char* path, bool writable = false);
+
+    char*  getData() const { return data; }
+    size_t getSize() const { return size; }
+
+    private:
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    char*   data;
+    size_t  size;
+};
+
+bool
+MappedFile::open(const char* path, bool writable) {
+
+    int fd = ::open(path, O_RDONLY);
+
+    if ( fd < 0 )
+        return false;
+
+    struct stat info;
+
+    if ( fstat(fd, &info) != 0 ) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return false;
+    }
+
+    size = info.st_size;
+
+    // an empty file is fine, there is nothing to map
+    if ( size > 0 ) {
+
+        void* mapping = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if ( mapping == MAP_FAILED ) {
+            int error = errno;
+            ::close(fd);
+            errno = error;
+            size  = 0;
+            return false;
+        }
+
+        data = static_cast<char*>(mapping);
+
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+
+    ::close(fd);
+
+    return true;
+}
+
+// writes all the bytes (retrying on signals and short
+// writes), false if it can't (see errno)
+inline bool writeFully(int fd, const char* data, size_t size) {
+
+    while ( size > 0 ) {
+
+        ssize_t written = ::write(fd, data, size);
+
+        if ( written < 0 && errno == EINTR )
+            continue;
+
+        if ( written <= 0 )
+            return false;
+
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+
+/*
+ * Response files
+ *
+ * Huge argument lists can be written in a file and passed as "@file"
+ * (see Parser::allowResponseFiles). The file is memory mapped and split
+ * in place: arguments are separated by blanks, can be quoted with '' or
+ * "" and a backslash escapes the next char (but not between '').
+ *
+ *      --username mariano -p 23
+ *      file1 'file with spaces' "another \"one\"" file\ 4
+ *
+ * Nothing is written on the mapping (it's read only), the arguments are
+ * views of it. Only the ones with quotes or escapes are copied (without
+ * them) into an arena of the file, and so the values of the options, as
+ * they're given null terminated to the options (see terminate).
+ */
+
+class ResponseFile {
+
+    public:
+
+    ResponseFile() : data(NULL), size(0), position(0), unterminatedQuote(false) {}
+
+    // false if it can't be mapped (see errno)
+    bool open(const char* path);
+
+    // the next argument (not null terminated), false at the end of
+    // the file or if it's wrong (see hasUnterminatedQuote)
+    bool next(std::string_view& argument);
+
+    // the last argument ends with a quote that is never closed
+    bool hasUnterminatedQuote() const { return unterminatedQuote; }
+
+    const std::string& getPath() const { return path; }
+
+    // a null terminated "argument" (or the tail of one) read from this
+    // file, valid while the file is open
+    const char* terminate(std::string_view argument);
+
+    private:
+
+    ResponseFile(const ResponseFile&);
+    ResponseFile& operator=(const ResponseFile&);
+
+    MappedFile  file;
+    std::string path;
+
+    const char* data;
+    size_t      size;
+    size_t      position;
+    bool        unterminatedQuote;
+
+    // the arguments without their quotes and escapes, and the
+    // null terminated copies of the ones in the mapping
+    TextArena   arena;
+    std::string unquoted;
+};
+
+bool
+ResponseFile::open(const char* filePath) {
+
+    if ( ! file.open(filePath) )
+        return false;
+
+    path = filePath;
+    data = file.getData();
+    size = file.getSize();
+
+    return true;
+}
+
+bool
+ResponseFile::next(std::string_view& argument) {
+
+    while ( position < size && isBlank(data[position]) )
+        ++position;
+
+    if ( position >= size )
+        return false;
+
+    const char* begin = data + position;
+
+    // most of them have no quotes nor escapes, they're given as they are
+    position += plainLength(begin, size - position);
+
+    if ( position == size || isBlank(data[position]) ) {
+        argument = std::string_view(begin, data + position - begin);
+        return true;
+    }
+
+    // and the rest are copied without them
+    unquoted.assign(begin, data + position - begin);
+
+    char quote = 0;
+
+    while ( position < size ) {
+
+        // the chars with no special meaning are copied at once
+        size_t plain = plainLength(data + position, size - position);
+
+        if ( plain > 0 ) {
+            unquoted.append(data + position, plain);
+            position += plain;
+            continue;
+        }
+
+        char c = data[position];
+
+        if ( quote == 0 && isBlank(c) )
+            break;
+
+        ++position;
+
+        if ( c == quote ) {
+            quote = 0;
+            continue;
+        }
+
+        if ( quote == 0 && ( c == '"' || c == '\'' ) ) {
+            quote = c;
+            continue;
+        }
+
+        if ( c == '\\' && quote != '\'' && position < size )
+            c = data[position++];
+
+        unquoted += c;
+    }
+
+    if ( quote != 0 ) {
+        unterminatedQuote = true;
+        return false;
+    }
+
+    argument = arena.copy(unquoted);
+
+    return true;
+}
+
+const char*
+ResponseFile::terminate(std::string_view argument) {
+
+    // the ones in the arena already are
+    if ( argument.data() < data || argument.data() >= data + size )
+        return argument.data();
+
+    return arena.copy(argument).data();
+}
+
+
+/*
+ * Config files
+ *
+ * Default values for the options can be read from "key = value" files
+ * (see Parser::loadConfig), with INI style sections:
+ *
+ *      # shared by all the tools
+ *      port = 8080
+ *      username = "mariano"
+ *
+ *      [server]
+ *      debug = yes
+ *
+ * Keys are long option names, blanks around keys and values are
+ * ignored, and so the quotes around a value. Lines starting with '#' or
+ * ';' are comments, and so the ones without '='. The file is mapped and
+ * the values are null terminated in place, nothing is converted until
+ * a parse needs it.
+ */
+
+class ConfigFile {
+
+    public:
+
+    ConfigFile() : data(NULL), size(0), position(0), lineNumber(0) {}
+
+    // false if it can't be mapped (see errno)
+    bool open(const char* path);
+
+    // the next "key = value", false at the end of the file. Both are
+    // valid while the file is open (and the value is null terminated)
+    bool next(std::string_view& section, std::string_view& key, std::string_view& value);
+
+    // the line of the last entry returned
+    size_t getLineNumber() const { return lineNumber; }
+
+    const std::string& getPath() const { return path; }
+
+    private:
+
+    ConfigFile(const ConfigFile&);
+    ConfigFile& operator=(const ConfigFile&);
+
+    MappedFile file;
+    std::string path;
+
+    char*   data;
+    size_t  size;
+    size_t  position;
+    size_t  lineNumber;
+
+    std::string_view currentSection;
+
+    // the last value when it has no room for its null
+    // terminator (it ends at the very end of the file)
+    std::string lastValue;
+
+    static std::string_view trim(const char* begin, const char* end) {
+
+        while ( begin != end && isBlank(*begin) )
+            ++begin;
+
+        while ( end != begin && isBlank(*(end - 1)) )
+            --end;
+
+        return std::string_view(begin, end - begin);
+    }
+};
+
+bool
+ConfigFile::open(const char* filePath) {
+
+    // (the values are null terminated in place)
+    if ( ! file.open(filePath, true) )
+        return false;
+
+    path = filePath;
+    data = file.getData();
+    size = file.getSize();
+
+    return true;
+}
+
+bool
+ConfigFile::next(std::string_view& section, std::string_view& key, std::string_view& value) {
+
+    while ( position < size ) {
+
+        char* line = data + position;
+        char* end  = static_cast<char*>( memchr(line, '\n', size - position) );
+
+        if ( end == NULL )
+            end = data + size;
+
+        position = ( end - data ) + 1;
+        ++lineNumber;
+
+        std::string_view text = trim(line, end);
+
+        if ( text.empty() || text[0] == '#' || text[0] == ';' )
+            continue;
+
+        if ( text[0] == '[' ) {
+
+            size_t close = text.find(']');
+
+            if ( close != std::string_view::npos )
+                currentSection = trim(text.data() + 1, text.data() + close);
+
+            continue;
+        }
+
+        size_t equal = findChar(text.data(), text.size(), '=');
+
+        if ( equal == text.size() )
+            continue;
+
+        key   = trim(text.data(), text.data() + equal);
+        value = trim(text.data() + equal + 1, text.data() + text.size());
+
+        if ( value.size() >= 2 && ( value[0] == '"' || value[0] == '\'' ) && value.back() == value[0] )
+            value = value.substr(1, value.size() - 2);
+
+        section = currentSection;
+
+        char* valueEnd = const_cast<char*>( value.data() ) + value.size();
+
+        // the rest of the line was already read, so the
+        // terminator can be written over it
+        if ( valueEnd == data + size ) {
+            lastValue.assign(value.data(), value.size());
+            value = lastValue;
+        }
+        else {
+            *valueEnd = '\0';
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+
+// the arguments to parse, from argv and from
+// the response files found on it
+class ArgumentReader {
+
+    public:
+
+    static const int MAX_DEPTH = 32;
+
+    // the arguments of a command are numbered from its name
+    // (firstNumber), as they are in the whole command line
+    ArgumentReader(int argc, char** argv, int firstNumber = 0)
+     : argCount(argc), argValues(argv), argIndex(1), argNumber(firstNumber), source(NULL), failed(NULL)
+    {}
+
+    bool next(std::string_view& argument) {
+
+        while ( ! files.empty() ) {
+
+            if ( files.back()->next(argument) ) {
+                source = files.back();
+                ++argNumber;
+                return true;
+            }
+
+            if ( files.back()->hasUnterminatedQuote() ) {
+                failed = files.back();
+                return false;
+            }
+
+            files.pop_back();
+        }
+
+        if ( argIndex >= argCount )
+            return false;
+
+        argument = argValues[argIndex++];
+        source   = NULL;
+        ++argNumber;
+
+        return true;
+    }
+
+    void push(ResponseFile* file) { files.push_back(file); }
+
+    int getDepth() const { return files.size(); }
+
+    // the position of the last argument read
+    int getArgNumber() const { return argNumber; }
+
+    // the last argument read (or the tail of it), null terminated
+    const char* terminate(std::string_view argument) const {
+        return ( source != NULL ) ? source->terminate(argument) : argument.data();
+    }
+
+    // the response file that can't be split, if any
+    const ResponseFile* getFailedFile() const { return failed; }
+
+    private:
+
+    int     argCount;
+    char**  argValues;
+    int     argIndex;
+    int     argNumber;
+
+    std::vector<ResponseFile*> files;
+
+    ResponseFile* source;   // where the last argument is (NULL for argv)
+    ResponseFile* failed;
+};
+
+
+/*
+ * Command streams
+ *
+ * To parse command lines read from a pipe or a socket (one command per
+ * line) without building an argv for each one. The data is fed as it
+ * arrives, in chunks of any size, and each complete line is split into
+ * arguments following the same rules as the response files (blanks
+ * separate them, '...' and "..." quote and '\' escapes, also the end
+ * of the line to continue it on the next one):
+ *
+ *      CommandStream stream("server");
+ *      ParseResult   result;
+ *
+ *      while ( stream.readFrom(socket) > 0 ) {
+ *
+ *          // all the lines received so far
+ *          while ( parser.parseNext(stream, result) )
+ *              run(result);
+ *      }
+ *
+ * Lines are split in place, in a buffer that is reused for all of them,
+ * so after the first few lines nothing is allocated. The arguments of a
+ * line (and the views of them in a ParseResult) are valid until the
+ * next line is read or more data is fed. Empty lines are skipped.
+ */
+
+class CommandStream {
+
+    public:
+
+    // "programName" is used as argv[0] of every line
+    CommandStream(const std::string& programName = "")
+     : name(programName), end(0), lineStart(0), readPos(0), writePos(0),
+       quote(0), escaped(false), inArgument(false), finished(false)
+    {}
+
+    // adds more data to split
+    void feed(const char* data, size_t length);
+
+    // reads what is available on the file descriptor straight into the
+    // buffer, returns what read() returns (0 once the input ended)
+    ssize_t readFrom(int fd, size_t maxBytes = 64 * 1024);
+
+    // there is no more data, so the last line doesn't need its '\n'.
+    // False if the input ended inside quotes or after a '\'
+    bool finish();
+
+    // the next complete line, false if there is none yet
+    bool next(int& argc, char**& argv);
+
+    private:
+
+    std::string name;
+
+    // the data fed, only [0, end) is used
+    std::vector<char> input;
+    size_t            end;
+
+    // the line being split: arguments are written from
+    // writePos on, over what was already read
+    size_t  lineStart;
+    size_t  readPos;
+    size_t  writePos;
+    char    quote;
+    bool    escaped;
+    bool    inArgument;
+    bool    finished;
+
+    std::vector<size_t> argumentStarts;
+    std::vector<char*>  argValues;
+
+    void reserve(size_t length);
+    void beginArgument();
+    void endArgument();
+};
+
+void
+CommandStream::reserve(size_t length) {
+
+    // drop the lines already returned, only the one
+    // being split (if any) is kept
+    if ( lineStart > 0 ) {
+
+        memmove(&input[0], &input[lineStart], end - lineStart);
+
+        for(size_t index=0; index < argumentStarts.size(); ++index)
+            argumentStarts[index] -= lineStart;
+
+        end      -= lineStart;
+        readPos  -= lineStart;
+        writePos -= lineStart;
+        lineStart = 0;
+    }
+
+    // + 1 for the terminator of an argument at the very end
+    if ( input.size() < end + length + 1 )
+        input.resize( std::max(end + length + 1, input.size() * 2) );
+}
+
+void
+CommandStream::feed(const char* data, size_t length) {
+
+    reserve(length);
+
+    memcpy(&input[end], data, length);
+    end += length;
+
+    finished = false;
+}
+
+ssize_t
+CommandStream::readFrom(int fd, size_t maxBytes) {
+
+    reserve(maxBytes);
+
+    ssize_t bytes = ::read(fd, &input[end], maxBytes);
+
+    if ( bytes > 0 ) {
+        end += bytes;
+        finished = false;
+    }
+
+    return bytes;
+}
+
+bool
+CommandStream::finish() {
+
+    bool complete = ( quote == 0 && !escaped );
+
+    finished = true;
+    quote    = 0;
+    escaped  = false;
+
+    return complete;
+}
+
+void
+CommandStream::beginArgument() {
+
+    if ( ! inArgument ) {
+        argumentStarts.push_back(writePos);
+        inArgument = true;
+    }
+}
+
+void
+CommandStream::endArgument() {
+
+    // it's never longer than what was read, so there is room for
+    // its terminator (reserve() leaves one more at the end)
+    if ( inArgument ) {
+        input[writePos++] = '\0';
+        inArgument = false;
+    }
+}
+
+bool
+CommandStream::next(int& argc, char**& argv) {
+
+    bool lineEnded = false;
+
+    while ( ! lineEnded ) {
+
+        // the state is kept between calls, so a line can
+        // arrive in as many pieces as needed
+        while ( readPos < end ) {
+
+            // the chars with no special meaning are moved at once
+            size_t plain = escaped ? 0 : plainLength(&input[readPos], end - readPos);
+
+            if ( plain > 0 ) {
+
+                if ( quote == 0 )
+                    beginArgument();
+
+                memmove(&input[writePos], &input[readPos], plain);
+
+                writePos += plain;
+                readPos  += plain;
+                continue;
+            }
+
+            char c = input[readPos++];
+
+            if ( escaped ) {
+
+                escaped = false;
+
+                // an escaped end of line joins both lines
+                if ( c != '\n' ) {
+                    beginArgument();
+                    input[writePos++] = c;
+                }
+
+                continue;
+            }
+
+            if ( quote != 0 ) {
+
+                if ( c == quote )
+                    quote = 0;
+                else if ( c == '\\' && quote == '"' )
+                    escaped = true;
+                else
+                    input[writePos++] = c;
+
+                continue;
+            }
+
+            if ( c == '\n' ) {
+                endArgument();
+                lineEnded = true;
+                break;
+            }
+
+            if ( isBlank(c) ) {
+                endArgument();
+                continue;
+            }
+
+            if ( c == '\\' ) {
+                escaped = true;
+                continue;
+            }
+
+            beginArgument();
+
+            if ( c == '"' || c == '\'' )
+                quote = c;
+            else
+                input[writePos++] = c;
+        }
+
+        if ( ! lineEnded ) {
+
+            // the last line may have no end of line
+            if ( ! finished || argumentStarts.empty() )
+                return false;
+
+            endArgument();
+            lineEnded = true;
+        }
+
+        // empty lines are skipped
+        if ( argumentStarts.empty() ) {
+            lineStart = writePos = readPos;
+            lineEnded = false;
+        }
+    }
+
+    argValues.clear();
+    argValues.push_back(&name[0]);
+
+    for(size_t index=0; index < argumentStarts.size(); ++index)
+        argValues.push_back(&input[ argumentStarts[index] ]);
+
+    argValues.push_back(NULL);
+
+    argumentStarts.clear();
+
+    lineStart = writePos = readPos;
+
+    argc = argValues.size() - 1;
+    argv = &argValues[0];
+
+    return true;
+}
+
+
+/*
+ * Environment snapshot
+ *
+ * The options can take its value from an environment variable when
+ * they're not in the command line. getenv() is a linear search, so
+ * instead of calling it for each option, each parser copies environ
+ * once (the first time an option is bound to a variable) and indexes
+ * it by name. Variables changed after that are not seen by the parser.
+ */
+
+extern char** environ;
+
+class EnvironmentSnapshot {
+
+    public:
+
+    EnvironmentSnapshot() : taken(false) {}
+
+    // the value of the variable, NULL if it's not set
+    const char* find(std::string_view name) {
+
+        // the parsers that don't read the environment don't pay for it
+        if ( ! taken )
+            take();
+
+        Index::const_iterator entry = index.find(name);
+
+        return ( entry != index.end() ) ? entry->second : NULL;
+    }
+
+    // flags take any value but "", "0", "false", "no" and "off"
+    static bool isTrue(const char* value) {
+
+        static const char* const falseValues[] = { "", "0", "false", "no", "off" };
+
+        for(size_t index=0; index < sizeof(falseValues) / sizeof(falseValues[0]); ++index) {
+            if ( strcasecmp(value, falseValues[index]) == 0 )
+                return false;
+        }
+
+        return true;
+    }
+
+    private:
+
+    EnvironmentSnapshot(const EnvironmentSnapshot&);
+    EnvironmentSnapshot& operator=(const EnvironmentSnapshot&);
+
+    // all the "NAME=VALUE" strings, one after the other
+    // (with their terminators), the index points into it
+    std::string data;
+
+    typedef std::unordered_map<std::string_view, const char*> Index;
+    Index index;
+
+    bool taken;
+
+    void take();
+};
+
+void
+EnvironmentSnapshot::take() {
+
+    taken = true;
+
+    if ( environ == NULL )
+        return;
+
+    size_t count = 0;
+    size_t bytes = 0;
+
+    for(char** variable = environ; *variable != NULL; ++variable, ++count)
+        bytes += strlen(*variable) + 1;
+
+    // one allocation for the strings, so
+    // the index can keep pointers into it
+    data.reserve(bytes);
+    index.reserve(count);
+
+    for(char** variable = environ; *variable != NULL; ++variable) {
+
+        const char* equal = strchr(*variable, '=');
+
+        if ( equal == NULL )
+            continue;
+
+        size_t start = data.size();
+
+        data.append(*variable, strlen(*variable) + 1);
+
+        const char* copy = data.data() + start;
+        size_t      nameLength = equal - *variable;
+
+        // the first one wins, as in getenv()
+        index.insert(std::make_pair(std::string_view(copy, nameLength), copy + nameLength + 1));
+    }
+}
+
+
+/*
+ * Parse errors
+ *
+ * parse() prints the usage and exits on any error, which is what a
+ * program wants for its own command line. To parse many command lines
+ * (ie: commands received by a daemon), tryParse() returns what went
+ * wrong instead, and it can be called again and again on the same
+ * parser (the options are reset before each parse):
+ *
+ *      const ParseError& error = parser.tryParse(argc, argv, otherArguments);
+ *
+ *      if ( error.failed() )
+ *          reply(error.message + "\n" + parser.getUsage());
+ */
+
+struct ParseError {
+
+    enum Code {
+        NONE = 0,
+        MALFORMED_ARGUMENT,     // "-" or "--"
+        UNKNOWN_OPTION,
+        AMBIGUOUS_OPTION,
+        MISSING_VALUE,          // the option needs a value and there is none
+        INVALID_VALUE,          // the value can't be converted
+        MISSING_MANDATORY,
+        RESPONSE_FILE,          // a response (or value) file can't be read
+        UNKNOWN_COMMAND,
+        HELP_REQUESTED          // not an error, but the parse stops there
+    };
+
+    ParseError() : code(NONE), argNumber(0) {}
+
+    bool failed() const { return code != NONE; }
+
+    Code        code;
+    int         argNumber;  // the argument where it was found (0 if none)
+    std::string message;    // the same text parse() prints
+
+    // for unknown or ambiguous options (and unknown commands), the
+    // closest long option names (or command names), if any. They're
+    // views of the interned names (see StringPool), never freed
+    std::vector<std::string_view> suggestions;
+};
+
+
+/*
+ * Parse statistics
+ *
+ * When enabled (see Parser::collectStats) the parser measures where
+ * the time goes on each parse:
+ *
+ *      tokenize  : reading the arguments and splitting names and values
+ *      lookup    : finding the options
+ *      conversion: converting (and storing) the values
+ *      mandatory : the final checks (help and mandatory options)
+ *
+ * and counts what it did. They can be read after the parse, or
+ * dumped as a JSON object:
+ *
+ *      parser.collectStats();
+ *      parser.parse(argc, argv);
+ *      parser.getStats().dump(std::cerr);
+ */
+
+struct ParseStats {
+
+    typedef std::chrono::steady_clock Clock;
+
+    ParseStats() { reset(); }
+
+    void reset() {
+        tokenizeTime       = 0;
+        lookupTime         = 0;
+        conversionTime     = 0;
+        mandatoryTime      = 0;
+        arguments          = 0;
+        lookups            = 0;
+        abbreviations      = 0;
+        conversions        = 0;
+        conversionFailures = 0;
+        valueBytes         = 0;
+    }
+
+    double totalTime() const {
+        return tokenizeTime + lookupTime + conversionTime + mandatoryTime;
+    }
+
+    void dump(std::ostream& out) const;
+
+    // wall time of each phase, in seconds
+    double  tokenizeTime;
+    double  lookupTime;
+    double  conversionTime;
+    double  mandatoryTime;
+
+    size_t  arguments;          // read from argv (and response files)
+    size_t  lookups;            // options searched
+    size_t  abbreviations;      // options found by an abbreviation
+    size_t  conversions;        // values given to the options
+    size_t  conversionFailures;
+    size_t  valueBytes;         // memory used by the values set
+};
+
+void
+ParseStats::dump(std::ostream& out) const {
+
+    out << "{"
+        << "\"tokenize_seconds\": "    << tokenizeTime       << ", "
+        << "\"lookup_seconds\": "      << lookupTime         << ", "
+        << "\"conversion_seconds\": "  << conversionTime     << ", "
+        << "\"mandatory_seconds\": "   << mandatoryTime      << ", "
+        << "\"total_seconds\": "       << totalTime()        << ", "
+        << "\"arguments\": "           << arguments          << ", "
+        << "\"lookups\": "             << lookups            << ", "
+        << "\"abbreviations\": "       << abbreviations      << ", "
+        << "\"conversions\": "         << conversions        << ", "
+        << "\"conversion_failures\": " << conversionFailures << ", "
+        << "\"value_bytes\": "         << valueBytes
+        << "}" << std::endl;
+}
+
+
+/*
+ * Parse state
+ *
+ * Everything a parse changes is kept in a ParseState, so the parser
+ * and its options are only read while parsing. The classic parse()
+ * stores the values in the options themselves (as it always did), and
+ * a ParseResult keeps them apart, by option, so once all the options
+ * were added, a Parser can be shared as an immutable schema by several
+ * threads, each one parsing into its own ParseResult:
+ *
+ *      IntegerOption port('p', "port", false, 23, "server port");
+ *      BoolOption    debug('d', "debug", false, "enables the debug mode");
+ *
+ *      parser.addOption(port).addOption(debug);
+ *
+ *      OptionHandle<IntegerOption> portHandle  = parser.getHandle(port);
+ *      OptionHandle<BoolOption>    debugHandle = parser.getHandle(debug);
+ *
+ *      // on each thread
+ *      ParseResult result;
+ *
+ *      if ( ! parser.parse(argc, argv, result).failed() ) {
+ *          int portValue = result.get(portHandle);     // O(1), no copies
+ *          bool debugSet = result.isSet(debugHandle);
+ *      }
+ *
+ * The options must know how to store its values out of them (see
+ * BaseOption::newValue and storeValue), all the ones here do.
+ */
+
+class ParseState {
+
+    public:
+
+    ParseState() : otherArguments(NULL), commandArguments(NULL), command(-1), commandArgNumber(0), statsEnabled(false) {}
+
+    virtual ~ParseState() {}
+
+    const ParseError& getError() const { return error; }
+    const ParseStats& getStats() const { return stats; }
+
+    // forgets the values read by the previous parses
+    virtual void reset() = 0;
+
+    protected:
+
+    friend class Parser;
+
+    // where the values go, options are identified
+    // by its position in the parser
+    virtual void prepare(size_t optionCount) {}
+    virtual bool wasFound(int index, BaseOption* option) = 0;
+    virtual void setFound(int index, BaseOption* option) = 0;
+    virtual ConversionResult setValue(int index, BaseOption* option, const char* value) = 0;
+    virtual size_t getValueBytes(int index, BaseOption* option) = 0;
+
+    // a line of a value file (it's not null terminated), by
+    // default it's copied to give it to setValue()
+    virtual ConversionResult setLine(int index, BaseOption* option, std::string_view line) {
+        lineBuffer.assign(line.data(), line.size());
+        return setValue(index, option, lineBuffer.c_str());
+    }
+
+    // the response and value files of the previous parse are not needed anymore
+    virtual void releaseResponseFiles() {
+        responseFiles.clear();
+        valueFiles.clear();
+    }
+
+    ParseError error;
+    std::vector<std::string_view>* otherArguments;
+
+    // when the commands are dispatched (see Parser::addCommand), the
+    // command found and its arguments (to be parsed by its parser),
+    // and the position of its name in the command line
+    std::vector<char*>* commandArguments;
+    int                 command;
+    int                 commandArgNumber;
+
+    // the response files the arguments were read from, and
+    // the value files of the lists (see readValueFile)
+    std::vector< std::unique_ptr<ResponseFile> > responseFiles;
+    std::vector< std::unique_ptr<MappedFile> >   valueFiles;
+    std::string                                  lineBuffer;
+
+    bool       statsEnabled;
+    ParseStats stats;
+    ParseStats::Clock::time_point lapStart;
+
+    // adds the time since the last lap to a phase of the stats
+    void lap(double ParseStats::* phase) {
+        if ( statsEnabled ) {
+            ParseStats::Clock::time_point now = ParseStats::Clock::now();
+            stats.*phase += std::chrono::duration<double>(now - lapStart).count();
+            lapStart = now;
+        }
+    }
+
+    // keeps the error, always returns false
+    bool fail(ParseError::Code code, int argNumber, const std::string& message) {
+
+        error.code      = code;
+        error.argNumber = argNumber;
+        error.message   = message;
+
+        return false;
+    }
+};
+
+
+// the values are stored in the options themselves
+class OptionsState : public ParseState {
+
+    public:
+
+    // only the options found since the last reset are visited
+    virtual void reset() {
+
+        for(size_t index=0; index < foundOptions.size(); ++index)
+            foundOptions[index]->reset();
+
+        foundOptions.clear();
+    }
+
+    protected:
+
+    virtual bool wasFound(int index, BaseOption* option) {
+        return option->isSet();
+    }
+
+    virtual void setFound(int index, BaseOption* option) {
+        track(option);
+        option->markAsFound();
+    }
+
+    virtual ConversionResult setValue(int index, BaseOption* option, const char* value) {
+        track(option);
+        option->setValue(value);
+        return option->getConversionResult();
+    }
+
+    virtual ConversionResult setLine(int index, BaseOption* option, std::string_view line) {
+        track(option);
+        return option->addLine(line);
+    }
+
+    virtual size_t getValueBytes(int index, BaseOption* option) {
+        return option->getValueBytes();
+    }
+
+    // lazy options could be pointing into them
+    virtual void releaseResponseFiles() {
+
+        if ( responseFiles.empty() && valueFiles.empty() )
+            return;
+
+        for(size_t index=0; index < foundOptions.size(); ++index)
+            foundOptions[index]->convertPending();
+
+        ParseState::releaseResponseFiles();
+    }
+
+    private:
+
+    std::vector<BaseOption*> foundOptions;
+
+    void track(BaseOption* option) {
+        if ( ! option->isSet() )
+            foundOptions.push_back(option);
+    }
+};
+
+
+// a typed reference to an option of a parser, to read its value
+// from a ParseResult (see Parser::getHandle)
+template<typename OPTION>
+class OptionHandle {
+
+    public:
+
+    // (an invalid one, as getHandle() gives for an unknown option)
+    OptionHandle() : index(-1), option(NULL) {}
+    OptionHandle(int idx, const OPTION* opt) : index(idx), option(opt) {}
+
+    bool isValid() const { return option != NULL; }
+
+    int           getIndex()  const { return index; }
+    const OPTION* getOption() const { return option; }
+
+    private:
+
+    int           index;
+    const OPTION* option;
+};
+
+
+class ParseResult : public ParseState {
+
+    public:
+
+    ParseResult& collectStats(bool collect = true) {
+        statsEnabled = collect;
+        return *this;
+    }
+
+    // they're valid until the next parse into this result
+    const std::vector<std::string_view>& getOtherArguments() const { return others; }
+
+    template<typename OPTION>
+    bool isSet(const OptionHandle<OPTION>& handle) const {
+
+        size_t index = handle.getIndex();
+
+        return index < values.size() && values[index] && values[index]->found;
+    }
+
+    // the value read, or the option default value (it throws
+    // std::invalid_argument for a handle that is not valid)
+    template<typename OPTION>
+    const typename OPTION::ValueType& get(const OptionHandle<OPTION>& handle) const {
+
+        typedef StoredValue<typename OPTION::ValueType> Stored;
+
+        if ( ! handle.isValid() )
+            throw std::invalid_argument("invalid option handle");
+
+        if ( ! isSet(handle) )
+            return handle.getOption()->getDefaultValue();
+
+        return static_cast<const Stored*>( values[handle.getIndex()].get() )->value;
+    }
+
+    // the values are kept (empty), so parsing again
+    // into this result doesn't need to allocate them
+    virtual void reset() {
+
+        for(size_t index=0; index < foundIndexes.size(); ++index)
+            values[ foundIndexes[index] ]->clear();
+
+        foundIndexes.clear();
+        others.clear();
+        responseFiles.clear();
+        valueFiles.clear();
+
+        error = ParseError();
+    }
+
+    protected:
+
+    virtual void prepare(size_t optionCount) {
+
+        if ( values.size() < optionCount )
+            values.resize(optionCount);
+
+        otherArguments = &others;
+    }
+
+    virtual bool wasFound(int index, BaseOption* option) {
+        return values[index] && values[index]->found;
+    }
+
+    virtual void setFound(int index, BaseOption* option) {
+        getStored(index, option).found = true;
+    }
+
+    virtual ConversionResult setValue(int index, BaseOption* option, const char* value) {
+
+        OptionValue& stored = getStored(index, option);
+
+        ConversionResult result = option->storeValue(stored, value);
+
+        if ( result.ok() )
+            stored.found = true;
+
+        return result;
+    }
+
+    virtual ConversionResult setLine(int index, BaseOption* option, std::string_view line) {
+
+        OptionValue& stored = getStored(index, option);
+
+        ConversionResult result = option->storeLine(stored, line);
+
+        if ( result.ok() )
+            stored.found = true;
+
+        return result;
+    }
+
+    virtual size_t getValueBytes(int index, BaseOption* option) {
+        return wasFound(index, option) ? values[index]->getValueBytes() : 0;
+    }
+
+    private:
+
+    // (writeSnapshot reads the values)
+    friend class Parser;
+
+    std::vector< std::unique_ptr<OptionValue> > values;
+    std::vector<int>                            foundIndexes;
+    std::vector<std::string_view>               others;
+
+    OptionValue& getStored(int index, const BaseOption* option) {
+
+        std::unique_ptr<OptionValue>& stored = values[index];
+
+        if ( ! stored )
+            stored.reset( option->newValue() );
+
+        if ( ! stored->found )
+            foundIndexes.push_back(index);
+
+        return *stored;
+    }
+};
+
+
+template<typename STRUCT>
+class StructParser;
+
+class Command;
+
+// builds the options of a command (see Parser::addCommand)
+typedef Command* (*CommandFactory)();
+
+class Parser {
+
+    template<typename STRUCT>
+    friend class StructParser;
+
+    public:
+    Parser() : helpOption(helpSpec()) {
+        for(int index=0; index < 256; ++index)
+            shortOptions[index] = NOT_FOUND;
+
+        // we provide the help option by default
+        addOption(helpOption);
+    }
+
+    // uses a compile time schema to look up the options, "schemaOptions"
+    // are the options described by each spec, in the same order (it
+    // throws std::invalid_argument when their names don't match)
+    template<size_t N, size_t NODES, size_t TABLE>
+    Parser(const StaticSchema<N, NODES, TABLE>& schema, BaseOption* (&schemaOptions)[N])
+     : helpOption(helpSpec()),
+       staticSchema(&schema), staticSize(N),
+       staticFindShort(&findInSchema< StaticSchema<N, NODES, TABLE> >),
+       staticFindLong(&findInSchema< StaticSchema<N, NODES, TABLE> >)
+    {
+        for(int index=0; index < 256; ++index)
+            shortOptions[index] = NOT_FOUND;
+
+        // the schema already knows how to find them, we only
+        // need them listed for the usage and the mandatory checks
+        options.reserve(N + 1);
+        options.push_back(&helpOption);
+
+        for(size_t index=0; index < N; ++index) {
+
+            const OptionSpec& spec = schema.getSpec(index);
+            BaseOption* option = schemaOptions[index];
+
+            // or the values would go to the wrong options
+            if ( option == NULL || option->getShortOption() != spec.shortOption ||
+                 option->getLongOptionView() != std::string_view(spec.longOption ? spec.longOption : "") ) {
+
+                std::stringstream message;
+                message << "option " << index << " is not the one of the schema ('"
+                        << ( spec.longOption ? spec.longOption : "" ) << "')";
+
+                throw std::invalid_argument(message.str());
+            }
+
+            checkValueFiles(*option);
+
+            options.push_back(option);
+
+            if ( schemaOptions[index]->isMandatory() )
+                mandatoryOptions.push_back(options.size() - 1);
+
+            bindEnvironment(options.size() - 1);
+        }
+    }
+
+    ~Parser();
+
+    Parser& addOption(BaseOption& option);
+
+    // adds a command (git style: "prog [options] command [its options]"),
+    // its options are only built, by "factory", when it's selected (see
+    // Command). Once a parser has commands, the first other argument
+    // must be one of them
+    Parser& addCommand(const char* name, const char* descr, CommandFactory factory);
+
+    template<typename COMMAND>
+    Parser& addCommand(const char* name, const char* descr = "") {
+        return addCommand(name, descr, &newCommand<COMMAND>);
+    }
+
+    // the command selected by the last parse (NULL if none)
+    Command* getCommand() const;
+
+    std::string getCommandName() const;
+
+    std::vector<std::string> parse(int argc, char** argv);
+
+    // the same as parse(), but the other arguments are returned as
+    // slices of argv, so they're valid as long as argv is (and the
+    // ones read from response files, until the next parse)
+    std::vector<std::string_view> parseViews(int argc, char** argv);
+
+    // resets the options and parses, but instead of exiting on errors it
+    // returns them (see ParseError). The other arguments are returned as
+    // in parseViews(), in a vector that can be reused between parses
+    const ParseError& tryParse(int argc, char** argv, std::vector<std::string_view>& otherArguments);
+
+    // forgets the values read by the previous parses, only
+    // the options found by them need to be visited
+    void reset();
+
+    // parses into "result" (see ParseState), the parser and its options
+    // are not changed, so it can be done by several threads at once
+    const ParseError& parse(int argc, char** argv, ParseResult& result) const;
+
+    // parses the next complete line of the stream into "result",
+    // false if there is none yet (see CommandStream)
+    bool parseNext(CommandStream& stream, ParseResult& result) const;
+
+    // to read the value of an option from a ParseResult
+    template<typename OPTION>
+    OptionHandle<OPTION> getHandle(const OPTION& option) const {
+
+        // this is done once per option, let's not index it
+        for(size_t index=0; index < options.size(); ++index) {
+            if ( options[index] == &option )
+                return OptionHandle<OPTION>(index, &option);
+        }
+
+        return OptionHandle<OPTION>();
+    }
+
+    // writes the values of "result" in a binary snapshot, so other
+    // processes can read them without parsing (see ParseSnapshot).
+    // False if an option has a value that can't be written
+    bool writeSnapshot(const ParseResult& result, std::string& blob) const;
+
+    // the same, but the snapshot is written to "fd" (ie: a memfd
+    // or a shared memory object the workers will map)
+    bool writeSnapshot(const ParseResult& result, int fd) const;
+
+    // identifies the options of the parser (its names and types), a
+    // snapshot can only be read by a parser with the same options
+    uint64_t getSchemaId() const;
+
+    // the options not found in the command line are read from the
+    // environment, from "prefix" + its long name in upper case and
+    // with '_' instead of '-' (ie: "--max-size" is APP_MAX_SIZE for
+    // the "APP_" prefix). The ones with setEnvironmentVariable() use
+    // that variable instead
+    Parser& bindEnvironment(const std::string& prefix);
+
+    // reads the values of the options from a config file (see
+    // ConfigFile), they're used when an option is neither in the
+    // command line nor in the environment. Only the keys out of any
+    // section and the ones in "section" are read, and the keys that
+    // are not options are ignored. Several files can be loaded, for
+    // a key in more than one, the last one loaded wins (but lists
+    // take all the values). False if the file can't be read (see errno)
+    bool loadConfig(const char* path, const std::string& section = "");
+
+    // measures each parse (see ParseStats)
+    Parser& collectStats(bool collect = true) {
+        ownState.statsEnabled = collect;
+        return *this;
+    }
+
+    const ParseStats& getStats() const { return ownState.stats; }
+
+    // when allowed, "@file" arguments are replaced by the
+    // arguments written in that file (see ResponseFile)
+    Parser& allowResponseFiles(bool allow = true) {
+        responseFilesAllowed = allow;
+        return *this;
+    }
+
+    // shell completion: once allowed, with "complete -o default -C prog prog"
+    // bash runs the program to ask for the options matching the word being
+    // completed, and parse() answers and exits. Parse before any other
+    // initialization (or call handleCompletion() even earlier) so it's fast
+    Parser& allowCompletion(bool allow = true) {
+        completionAllowed = allow;
+        return *this;
+    }
+
+    // answers (and exits) if this is a completion request from the shell:
+    // COMP_LINE and COMP_POINT are set and argv[1] is the line's first word
+    void handleCompletion(int argc, char** argv) const;
+
+    // the options (as they'd be typed) that can complete "word", ie:
+    // "--po" gives "--port" and "--portability", "-" gives all of them
+    void complete(std::string_view word, std::vector<std::string>& completions) const;
+
+    // the option a long name (without the dashes, it can be abbreviated)
+    // or a short one stands for, as parse() finds it. NULL if there is
+    // none (or the abbreviation is ambiguous)
+    const BaseOption* lookupOption(std::string_view longOption) const;
+    const BaseOption* lookupOption(char shortOption) const;
+
+    void usage(const std::string& text) { usage(text.c_str()); }
+    void usage(const char* text = "");
+
+    // the usage text (without exiting)
+    std::string getUsage();
+
+    private:
+
+    enum { NOT_FOUND = -1 };
+
+    BoolOption helpOption;
+
+    static const OptionSpec& helpSpec() {
+        return helpOptionSpec;
+    }
+
+    // options are identified by its position here,
+    // the help option is always the first one
+    std::vector<BaseOption*> options;
+    std::vector<int>         mandatoryOptions;
+    std::string programName;
+
+    // the state of parse(), parseViews() and tryParse()
+    OptionsState ownState;
+
+    // the commands, by name. Only parse(), parseViews() and
+    // tryParse() dispatch them, the other parses take the
+    // command and its arguments as other arguments
+    // (the texts are interned, so the suggestions of an
+    // error can point to the names, see selectCommand)
+    struct CommandEntry {
+        std::string_view name;
+        std::string_view description;
+        CommandFactory  factory;
+        Command*        command;        // built when it's first selected
+    };
+
+    std::vector<CommandEntry> commands;
+    std::vector<char*>        commandArguments;
+
+    template<typename COMMAND>
+    static Command* newCommand() { return new COMMAND(); }
+
+    bool selectCommand(std::string_view name, ArgumentReader& reader, ParseState& state) const;
+
+    Parser* parseCommand(std::vector<std::string_view>& otherArguments);
+
+    // environment values of the options, they're looked up
+    // once, when the option is added or bound
+    EnvironmentSnapshot environment;
+    std::string         environmentPrefix;
+
+    struct EnvironmentValue {
+        int          option;
+        std::string  variable;
+        const char*  value;
+    };
+
+    std::vector<EnvironmentValue> environmentValues;
+
+    void bindEnvironment(int index);
+
+    bool readEnvironment(ParseState& state) const;
+
+    // config file values of the options, by option (the
+    // values are converted only when a parse needs them)
+    std::vector< std::unique_ptr<ConfigFile> > configFiles;
+
+    struct ConfigValue {
+        int          option;
+        const char*  value;
+        ConfigFile*  file;
+        size_t       lineNumber;
+
+        static bool byOption(const ConfigValue& a, const ConfigValue& b) {
+            return a.option < b.option;
+        }
+    };
+
+    std::vector<ConfigValue> configValues;
+
+    int findExactOption(std::string_view longOpt) const;
+
+    bool readConfig(ParseState& state) const;
+
+    // (firstArgNumber is the position of argv[0] in the
+    // command line, it's not 0 for the commands)
+    bool parseArguments(int argc, char** argv, ParseState& state, int firstArgNumber = 0) const;
+
+    bool responseFilesAllowed = false;
+    bool completionAllowed = false;
+
+    bool nextArgument(ArgumentReader& reader, std::string_view& argument, ParseState& state) const;
+    static bool unterminatedQuote(const ArgumentReader& reader, ParseState& state);
+
+    // only the options that take lines can read value files
+    static void checkValueFiles(const BaseOption& option) {
+        if ( option.acceptsValueFiles() && ! option.takesLines() )
+            throw std::invalid_argument("option '" + option.getLongOption() + "' can't take value files");
+    }
+
+    bool readValueFile(int index, BaseOption* option, const char* path, std::string_view argument, int argNumber, ParseState& state) const;
+
+    // lookup indexes, maintained by addOption():
+    //   short options are indexed directly by its char,
+    //   long ones by its folded name (exact matches) and
+    //   in a prefix tree (abbreviations)
+    int shortOptions[256];
+    typedef std::unordered_map<std::string_view, int, FoldedHash, FoldedEqual> LongOptionsIndex;
+
+    LongOptionsIndex longOptions;
+    OptionTrie  longOptionsTrie;
+
+    // compile time schema (if any), searched before the indexes
+    const void*  staticSchema = NULL;
+    size_t       staticSize = 0;
+    int          (*staticFindShort)(const void*, char) = NULL;
+    int          (*staticFindLong)(const void*, const char*, size_t) = NULL;
+
+    template<typename SCHEMA>
+    static int findInSchema(const void* schema, char shortOpt) {
+        return static_cast<const SCHEMA*>(schema)->findOption(shortOpt);
+    }
+
+    template<typename SCHEMA>
+    static int findInSchema(const void* schema, const char* longOpt, size_t length) {
+        return static_cast<const SCHEMA*>(schema)->findOption(longOpt, length);
+    }
+
+    int getStaticOption(int index) const {
+        // the schema puts the help option after the specs
+        return ( index == (int) staticSize ) ? 0 : index + 1;
+    }
+
+    // the schema finds abbreviations too, as long as the option name
+    bool isExactName(int index, std::string_view longOption) const {
+
+        std::string_view name = options[index]->getLongOptionView();
+
+        return name.size() == longOption.size() &&
+               foldedPrefixLength(longOption.data(), name.data(), name.size()) == name.size();
+    }
+
+    int findOption(char shortOpt, ParseState& state) const;
+    int findOption(std::string_view longOpt, ParseState& state) const;
+    int findAddedAbbreviation(int schemaOption, std::string_view longOpt, ParseState& state) const;
+
+    void ambiguousOption(std::string_view longOpt, const std::vector<int>& candidates, ParseState& state) const;
+
+    void suggestOptions(std::string_view longOpt, const std::vector<int>* candidates, ParseState& state) const;
+
+    static void appendSuggestions(ParseError& error, const char* prefix);
+
+    std::string getOptionText(BaseOption* option, const char* separator) const;
+
+    void appendOptionText(std::string& text, BaseOption* option, const char* separator) const;
+
+    // the usage text (but the program name), rendered
+    // once for all the options (see getUsage)
+    std::string usageText;
+    bool        usageValid = false;
+
+    void renderUsage(std::string& text) const;
+
+};
+
+std::vector<std::string>
+Parser::parse(int argc, char** argv) {
+
+    std::vector<std::string_view> otherArguments = parseViews(argc, argv);
+
+    return std::vector<std::string>(otherArguments.begin(), otherArguments.end());
+}
+
+std::vector<std::string_view>
+Parser::parseViews(int argc, char** argv) {
+
+    std::vector<std::string_view> otherArguments;
+
+    if ( completionAllowed )
+        handleCompletion(argc, argv);
+
+    // first argument is the program name
+    if ( argc >= 1 )
+        programName = argv[0];
+
+    ownState.otherArguments   = &otherArguments;
+    ownState.commandArguments = &commandArguments;
+
+    if ( ! parseArguments(argc, argv, ownState) ) {
+        // the help option has no message, only the usage
+        usage(ownState.error.message);
+    }
+
+    if ( ownState.command != NOT_FOUND ) {
+
+        Parser* commandParser = parseCommand(otherArguments);
+
+        if ( commandParser->ownState.error.failed() )
+            commandParser->usage(commandParser->ownState.error.message);
+    }
+
+    return otherArguments;
+}
+
+const ParseError&
+Parser::tryParse(int argc, char** argv, std::vector<std::string_view>& otherArguments) {
+
+    if ( completionAllowed )
+        handleCompletion(argc, argv);
+
+    reset();
+
+    otherArguments.clear();
+
+    if ( argc >= 1 )
+        programName = argv[0];
+
+    ownState.otherArguments   = &otherArguments;
+    ownState.commandArguments = &commandArguments;
+
+    if ( parseArguments(argc, argv, ownState) && ownState.command != NOT_FOUND ) {
+
+        // the errors of the command are the errors of the parse
+        Parser* commandParser = parseCommand(otherArguments);
+
+        if ( commandParser->ownState.error.failed() )
+            ownState.error = commandParser->ownState.error;
+    }
+
+    return ownState.error;
+}
+
+const ParseError&
+Parser::parse(int argc, char** argv, ParseResult& result) const {
+
+    if ( completionAllowed )
+        handleCompletion(argc, argv);
+
+    result.reset();
+
+    parseArguments(argc, argv, result);
+
+    return result.error;
+}
+
+// the options that weren't in the command line
+// take the values of its environment variables
+bool
+Parser::readEnvironment(ParseState& state) const {
+
+    for(size_t index=0; index < environmentValues.size(); ++index) {
+
+        const EnvironmentValue& binding = environmentValues[index];
+
+        BaseOption* option = options[binding.option];
+
+        if ( state.wasFound(binding.option, option) )
+            continue;
+
+        if ( ! option->needArgument() ) {
+
+            if ( EnvironmentSnapshot::isTrue(binding.value) )
+                state.setFound(binding.option, option);
+
+            continue;
+        }
+
+        ConversionResult conversion = state.setValue(binding.option, option, binding.value);
+
+        if ( state.statsEnabled ) {
+            state.stats.conversions++;
+
+            if ( ! conversion.ok() )
+                state.stats.conversionFailures++;
+        }
+
+        if ( ! conversion.ok() ) {
+            std::stringstream message;
+            message << "Invalid value '" << binding.value << "' for option '" << getOptionText(option, "|")
+                    << "' (from " << binding.variable << "): "
+                    << conversion.describe() << " (see position " << conversion.position << ")";
+            return state.fail(ParseError::INVALID_VALUE, 0, message.str());
+        }
+    }
+
+    state.lap(&ParseStats::conversionTime);
+
+    return true;
+}
+
+// the options that weren't in the command line nor
+// in the environment take the values of the config files
+bool
+Parser::readConfig(ParseState& state) const {
+
+    bool skipOption = false;
+
+    for(size_t index=0; index < configValues.size(); ++index) {
+
+        const ConfigValue& config = configValues[index];
+
+        BaseOption* option = options[config.option];
+
+        // they're sorted by option, so this is only
+        // checked before its first value
+        if ( index == 0 || configValues[index - 1].option != config.option )
+            skipOption = state.wasFound(config.option, option);
+
+        if ( skipOption )
+            continue;
+
+        if ( ! option->needArgument() ) {
+
+            if ( EnvironmentSnapshot::isTrue(config.value) )
+                state.setFound(config.option, option);
+
+            continue;
+        }
+
+        ConversionResult conversion = state.setValue(config.option, option, config.value);
+
+        if ( state.statsEnabled ) {
+            state.stats.conversions++;
+
+            if ( ! conversion.ok() )
+                state.stats.conversionFailures++;
+        }
+
+        if ( ! conversion.ok() ) {
+            std::stringstream message;
+            message << "Invalid value '" << config.value << "' for option '" << getOptionText(option, "|")
+                    << "' (from " << config.file->getPath() << ":" << config.lineNumber << "): "
+                    << conversion.describe() << " (see position " << conversion.position << ")";
+            return state.fail(ParseError::INVALID_VALUE, 0, message.str());
+        }
+    }
+
+    state.lap(&ParseStats::conversionTime);
+
+    return true;
+}
+
+bool
+Parser::parseNext(CommandStream& stream, ParseResult& result) const {
+
+    int    argc;
+    char** argv;
+
+    if ( ! stream.next(argc, argv) )
+        return false;
+
+    parse(argc, argv, result);
+
+    return true;
+}
+
+bool
+Parser::parseArguments(int argc, char** argv, ParseState& state, int firstArgNumber) const {
+
+    state.error   = ParseError();
+    state.command = NOT_FOUND;
+
+    // the files mapped by a previous parse are not needed anymore
+    state.releaseResponseFiles();
+
+    state.prepare(options.size());
+
+    std::vector<std::string_view>& otherArguments = *state.otherArguments;
+
+    ArgumentReader reader(argc, argv, firstArgNumber);
+    std::string_view argument;
+
+    if ( state.statsEnabled ) {
+        state.stats.reset();
+        state.lapStart = ParseStats::Clock::now();
+    }
+
+    // now, start iterating over each argument
+    while ( nextArgument(reader, argument, state) ) {
+
+        // everything here is a slice of argv (or of a response
+        // file), nothing is copied
+        int argNumber = reader.getArgNumber();
+
+        // arguments start with "-"
+        // if not, push it into "other inputs"
+        if ( argument.empty() )
+            continue;
+
+        if ( argument[0] != '-' ) {
+
+            // the rest of the arguments are for the command
+            if ( state.commandArguments != NULL && ! commands.empty() ) {
+
+                if ( ! selectCommand(argument, reader, state) )
+                    return false;
+
+                break;
+            }
+
+            // add it as other argument and continue with the next arg
+            otherArguments.push_back( argument );
+            state.lap(&ParseStats::tokenizeTime);
+            continue;        
+        }
+
+        // this is a malformed argument:
+        // "-"
+        if ( argument.length() < 2 ) {
+            std::stringstream message;
+            message << "Malformed argument! (see arg number " << argNumber << ")";
+            return state.fail(ParseError::MALFORMED_ARGUMENT, argNumber, message.str());
+        }
+
+        int optionIndex = NOT_FOUND;
+
+        std::string_view possibleValue;
+
+        // (without the dashes and the value)
+        std::string_view optionName;
+
+        // now, if the next char is a '-' it's a long option,
+        // if not, it's a short one
+        if ( argument[1] != '-' ) {
+
+            state.lap(&ParseStats::tokenizeTime);
+
+            optionIndex = findOption(argument[1], state);
+
+            state.lap(&ParseStats::lookupTime);
 
             // this looks like a short option, so let's check if there
             // are no more chars here, then we pick the value from here
@@ -656,264 +5060,1984 @@ Parser::parse(int argc, char** argv) {
             }
 
 
-        }
-        else {
-            
-            // this looks like a long option, so let's check if there
-            // are no more chars here, if not, that's malformed
-            if ( argument.length() < 3 ) {
-                std::stringstream error;
-                error << "Malformed argument! (see arg number " << argNumber << ")";
-                usage(error.str());
-            }
+        }
+        else {
+            
+            // this looks like a long option, so let's check if there
+            // are no more chars here, if not, that's malformed
+            if ( argument.length() < 3 ) {
+                std::stringstream message;
+                message << "Malformed argument! (see arg number " << argNumber << ")";
+                return state.fail(ParseError::MALFORMED_ARGUMENT, argNumber, message.str());
+            }
+
+            // let's allow the separation between key and value by '='
+            // on long options
+            std::string_view optionAndValueStr = argument.substr(2);
+
+            // initially we suppose there is no value
+            std::string_view optionStr = optionAndValueStr;
+
+            size_t separator = findChar(optionStr.data(), optionStr.size(), '=');
+
+            if ( separator != optionStr.size() ) {
+                optionStr     = optionAndValueStr.substr(0, separator);
+                possibleValue = optionAndValueStr.substr(separator+1);
+            }
+
+            state.lap(&ParseStats::tokenizeTime);
+
+            optionIndex = findOption( optionStr, state );
+            optionName  = optionStr;
+
+            state.lap(&ParseStats::lookupTime);
+
+        }
+
+        if ( optionIndex == NOT_FOUND ) {
+
+            // it could have been ambiguous
+            if ( state.error.failed() ) {
+                state.error.argNumber = argNumber;
+                return false;
+            }
+
+            std::stringstream message;
+            message << "Unknown option '" << argument << "' (see arg number " << argNumber << ")";
+
+            state.fail(ParseError::UNKNOWN_OPTION, argNumber, message.str());
+
+            if ( ! optionName.empty() )
+                suggestOptions(optionName, NULL, state);
+
+            return false;
+        }
+
+        BaseOption* option = options[optionIndex];
+
+        // let's see if this needs an argument
+        if ( option->needArgument() ) {
+
+            const char* value = NULL;
+
+            if ( possibleValue.empty() ) {
+
+                // try to get the next one or fail
+                std::string_view nextArg;
+
+                if ( nextArgument(reader, nextArg, state) ) {
+
+                    // the next argument is the value
+                    value = reader.terminate(nextArg);
+
+                }
+                else if ( state.error.failed() ) {
+                    // the response file can't be read
+                    return false;
+                }
+                else {
+                    std::stringstream message;
+                    message << "Option '" << argument << "' needs an additional argument";
+                    return state.fail(ParseError::MISSING_VALUE, argNumber, message.str());
+                }
+
+            }
+            else {
+                // the value we got directly from the option:
+                //   --key=value or -kvalue
+                // (it's the tail of the argument, so it's null
+                // terminated if the argument is)
+                value = reader.terminate(possibleValue);
+            }
+
+            state.lap(&ParseStats::tokenizeTime);
+
+            if ( option->acceptsValueFiles() && value[0] == '@' ) {
+
+                // "@@..." is a value starting with '@'
+                if ( value[1] == '@' ) {
+                    ++value;
+                }
+                else if ( value[1] != '\0' ) {
+
+                    if ( ! readValueFile(optionIndex, option, value + 1, argument, argNumber, state) )
+                        return false;
+
+                    continue;
+                }
+            }
+
+            ConversionResult conversion = state.setValue(optionIndex, option, value);
+
+            if ( state.statsEnabled ) {
+                state.stats.conversions++;
+
+                if ( ! conversion.ok() )
+                    state.stats.conversionFailures++;
+            }
+
+            state.lap(&ParseStats::conversionTime);
+
+            if ( ! conversion.ok() ) {
+                std::stringstream message;
+                message << "Invalid value '" << value << "' for option '" << argument << "': "
+                        << conversion.describe() << " (see position " << conversion.position << ")";
+                return state.fail(ParseError::INVALID_VALUE, argNumber, message.str());
+            }
+
+        }
+        else {
+            // set as read
+            state.setFound(optionIndex, option);
+        }
+
+    }
+
+    // the response file can't be read
+    if ( state.error.failed() )
+        return false;
+
+    if ( ! readEnvironment(state) || ! readConfig(state) )
+        return false;
+
+    // now, let's do some basic checking
+
+    // was the help option requested?
+    if ( state.wasFound(0, options[0]) ) {
+        return state.fail(ParseError::HELP_REQUESTED, 0, "");
+    }
+
+    // let's go thru all the options to get all the
+    // ones that are mandatories and that weren't
+    // set
+   
+    std::string mandatoriesError; 
+
+    for(std::vector<int>::const_iterator iter = mandatoryOptions.begin();
+        iter != mandatoryOptions.end();
+        ++iter
+    ) {
+
+        BaseOption* option = options[*iter];
+
+        if ( !state.wasFound(*iter, option) ) {
+
+            if ( ! mandatoriesError.empty() )
+                mandatoriesError += ", ";
+
+            mandatoriesError += getOptionText(option, "|");
+        }
+
+    }
+
+    if ( state.statsEnabled ) {
+
+        state.stats.arguments = reader.getArgNumber();
+
+        for(size_t index=0; index < options.size(); ++index)
+            state.stats.valueBytes += state.getValueBytes(index, options[index]);
+
+        state.lap(&ParseStats::mandatoryTime);
+    }
+
+    if ( ! mandatoriesError.empty() ) {
+        return state.fail(ParseError::MISSING_MANDATORY, 0, "The following arguments are mandatory: " + mandatoriesError);
+    }
+
+    return true;
+}
+
+
+void
+Parser::usage(const char* text) {
+
+    // everything in one write, the help of big
+    // schemas is not streamed piece by piece
+    std::string output;
+
+    if ( strcmp(text, "") != 0 ) {
+        output += text;
+        output += '\n';
+    }
+
+    output += getUsage();
+
+    std::cout.flush();
+    std::cerr.flush();
+
+    writeFully(STDERR_FILENO, output.data(), output.size());
+
+    // end
+    exit(1);
+
+}
+
+std::string
+Parser::getUsage() {
+
+    // the text of the options only changes when one is added
+    if ( ! usageValid ) {
+        renderUsage(usageText);
+        usageValid = true;
+    }
+
+    std::string text;
+
+    text.reserve( 8 + programName.size() + usageText.size() );
+
+    text += "Usage: ";
+    text += programName;
+    text += " ";
+    text += usageText;
+
+    return text;
+
+}
+
+// everything after the program name
+void
+Parser::renderUsage(std::string& text) const {
+
+    const size_t maxWidth = 30;
+
+    std::string optionsSummary;
+    std::string fullDescription;
+
+    for(std::vector<BaseOption*>::const_iterator iter = options.begin();
+        iter != options.end();
+        ++iter
+    ) {
+
+        BaseOption* option = *iter;
+
+        // this is the syntax:
+        //   [ ] => optional
+        //   short|long
+        if ( ! option->isMandatory() )
+            optionsSummary += '[';
+
+        appendOptionText(optionsSummary, option, "|");
+
+        if ( option->needArgument() )
+            optionsSummary += " value";
+
+        if ( ! option->isMandatory() )
+            optionsSummary += ']';
+
+        optionsSummary += ' ';
+
+        // full description
+        size_t start = fullDescription.size();
+
+        fullDescription += ' ';
+
+        appendOptionText(fullDescription, option, ", ");
+
+        if ( option->needArgument() )
+            fullDescription += " value";
+
+        size_t width = fullDescription.size() - start - 1;
+
+        if ( width < maxWidth )
+            fullDescription.append(maxWidth - width, ' ');
+
+        fullDescription += "\t\t";
+        fullDescription += option->getDescriptionView();
+        fullDescription += '\n';
+    }
+
+    std::string commandsDescription;
+
+    if ( ! commands.empty() ) {
+
+        optionsSummary += "command [command options] ";
+
+        for(size_t index=0; index < commands.size(); ++index) {
+
+            commandsDescription += ' ';
+            commandsDescription += commands[index].name;
+
+            if ( commands[index].name.size() < maxWidth )
+                commandsDescription.append(maxWidth - commands[index].name.size(), ' ');
+
+            commandsDescription += "\t\t";
+            commandsDescription += commands[index].description;
+            commandsDescription += '\n';
+        }
+    }
+
+    text.clear();
+    text.reserve( optionsSummary.size() + fullDescription.size() + commandsDescription.size() + 32 );
+
+    text += optionsSummary;
+    text += "\nOptions:\n";
+    text += fullDescription;
+
+    if ( ! commands.empty() ) {
+        text += "\nCommands:\n";
+        text += commandsDescription;
+    }
+
+}
+
+bool
+Parser::nextArgument(ArgumentReader& reader, std::string_view& argument, ParseState& state) const {
+
+    while ( reader.next(argument) ) {
+
+        if ( !responseFilesAllowed || argument.size() < 2 || argument[0] != '@' )
+            return true;
+
+        const char* path = reader.terminate(argument.substr(1));
+
+        // let's continue reading from the response file
+        if ( reader.getDepth() >= ArgumentReader::MAX_DEPTH ) {
+            std::stringstream message;
+            message << "Too many nested response files (see '" << argument << "')";
+            return state.fail(ParseError::RESPONSE_FILE, reader.getArgNumber(), message.str());
+        }
+
+        std::unique_ptr<ResponseFile> file(new ResponseFile());
+
+        if ( ! file->open(path) ) {
+            std::stringstream message;
+            message << "Unable to read the response file '" << argument.substr(1) << "': " << strerror(errno);
+            return state.fail(ParseError::RESPONSE_FILE, reader.getArgNumber(), message.str());
+        }
+
+        reader.push(file.get());
+        state.responseFiles.push_back(std::move(file));
+    }
+
+    if ( reader.getFailedFile() != NULL )
+        return unterminatedQuote(reader, state);
+
+    return false;
+}
+
+bool
+Parser::unterminatedQuote(const ArgumentReader& reader, ParseState& state) {
+
+    std::stringstream message;
+    message << "Unterminated quote in the response file '" << reader.getFailedFile()->getPath() << "'";
+
+    return state.fail(ParseError::RESPONSE_FILE, reader.getArgNumber() + 1, message.str());
+}
+
+// the values of a list read from a file, one per line. The lines are
+// given to the list as they're in the mapping (nothing is written on
+// it, so its pages are the ones of the page cache), and the mapping
+// is kept by the state until the next parse
+bool
+Parser::readValueFile(int index, BaseOption* option, const char* path, std::string_view argument, int argNumber, ParseState& state) const {
+
+    std::unique_ptr<MappedFile> file(new MappedFile());
+
+    if ( ! file->open(path) ) {
+        std::stringstream message;
+        message << "Unable to read the values file '" << path << "': " << strerror(errno);
+        return state.fail(ParseError::RESPONSE_FILE, argNumber, message.str());
+    }
+
+    const char* data = file->getData();
+    size_t      size = file->getSize();
+
+    // (the values read are kept, even if a line is wrong)
+    state.valueFiles.push_back(std::move(file));
+
+    size_t lineNumber = 0;
+    size_t lines = 0;
+
+    for(size_t start=0; start < size; ) {
+
+        size_t end = start + findChar(data + start, size - start, '\n');
+        std::string_view line(data + start, end - start);
+
+        start = end + 1;
+        ++lineNumber;
+
+        if ( ! line.empty() && line.back() == '\r' )
+            line.remove_suffix(1);
+
+        if ( line.empty() )
+            continue;
+
+        ConversionResult conversion = state.setLine(index, option, line);
+
+        ++lines;
+
+        if ( state.statsEnabled ) {
+            state.stats.conversions++;
+
+            if ( ! conversion.ok() )
+                state.stats.conversionFailures++;
+        }
+
+        if ( ! conversion.ok() ) {
+            std::stringstream message;
+            message << "Invalid value '" << line << "' for option '" << argument << "' (from " << path
+                    << " line " << lineNumber << "): "
+                    << conversion.describe() << " (see position " << conversion.position << ")";
+            return state.fail(ParseError::INVALID_VALUE, argNumber, message.str());
+        }
+    }
+
+    // an empty file is an empty list
+    if ( lines == 0 )
+        state.setFound(index, option);
+
+    state.lap(&ParseStats::conversionTime);
+
+    return true;
+}
+
+void
+Parser::handleCompletion(int argc, char** argv) const {
+
+    // bash gives the command, the word and the previous word, and the
+    // whole line and the cursor in the environment (only once, there is
+    // no need of the snapshot). But bash also exports them to whatever
+    // runs while completing, so the command must be the first word of
+    // the line too (or it's a program run by a completion function)
+    if ( argc < 3 || argc > 4 )
+        return;
+
+    const char* line  = getenv("COMP_LINE");
+    const char* point = getenv("COMP_POINT");
+
+    if ( line == NULL || point == NULL )
+        return;
+
+    while ( isBlank(*line) )
+        ++line;
+
+    size_t length = 0;
+
+    while ( line[length] != '\0' && ! isBlank(line[length]) )
+        ++length;
+
+    if ( std::string_view(line, length) != argv[1] )
+        return;
+
+    std::string_view word = argv[2];
+
+    std::vector<std::string> completions;
+
+    // the word is the value of the previous option, let
+    // the shell complete it (ie: as a file name)
+    bool isValue = false;
+
+    if ( argc >= 4 && argv[3][0] == '-' && argv[3][1] != '\0' && word.substr(0, 1) != "-" ) {
+
+        std::string_view previous = argv[3];
+        OptionsState state;
+
+        int index = ( previous[1] == '-' ) ? findOption(previous.substr(2), state)
+                                           : ( previous.size() == 2 ? findOption(previous[1], state) : NOT_FOUND );
+
+        isValue = ( index != NOT_FOUND && options[index]->needArgument() );
+    }
+
+    if ( ! isValue )
+        complete(word, completions);
+
+    std::string output;
+
+    for(size_t index=0; index < completions.size(); ++index) {
+        output += completions[index];
+        output += '\n';
+    }
+
+    std::cout.flush();
+
+    writeFully(STDOUT_FILENO, output.data(), output.size());
+
+    exit(0);
+}
+
+void
+Parser::complete(std::string_view word, std::vector<std::string>& completions) const {
+
+    // values and "--name=value" are not completed here
+    if ( ( ! word.empty() && word[0] != '-' ) || word.find('=') != std::string_view::npos )
+        return;
+
+    // a short option is already complete
+    if ( word.size() == 2 && word[1] != '-' ) {
+
+        if ( shortOptions[ (unsigned char) word[1] ] != NOT_FOUND ||
+             ( staticSchema != NULL && staticFindShort(staticSchema, word[1]) >= 0 ) )
+            completions.push_back(std::string(word));
+
+        return;
+    }
+
+    if ( word.size() > 2 && word[1] != '-' )
+        return;
+
+    std::string_view prefix = ( word.size() >= 2 ) ? word.substr(2) : std::string_view();
+
+    // all of them, the short ones too
+    if ( word.size() < 2 ) {
+        for(size_t index=0; index < options.size(); ++index) {
+            if ( options[index]->hasShortOption() )
+                completions.push_back(std::string("-") + options[index]->getShortOption());
+        }
+    }
+
+    // the compile time schema has no way to list them, but it's
+    // only a prefix comparison for each of its options
+    for(size_t index=0; index < options.size() && index <= staticSize && staticSchema != NULL; ++index) {
+
+        std::string_view name = options[index]->getLongOptionView();
+
+        if ( name.size() >= prefix.size() && foldedPrefixLength(name.data(), prefix.data(), prefix.size()) == prefix.size() )
+            completions.push_back("--" + std::string(name));
+    }
+
+    std::vector<int> found;
+    longOptionsTrie.complete(prefix.data(), prefix.size(), found);
+
+    for(size_t index=0; index < found.size(); ++index)
+        completions.push_back("--" + std::string(options[ found[index] ]->getLongOptionView()));
+}
+
+std::string
+Parser::getOptionText(BaseOption* option, const char* separator) const {
+
+    std::string optionBase;
+
+    appendOptionText(optionBase, option, separator);
+
+    return optionBase;
+}
+
+void
+Parser::appendOptionText(std::string& text, BaseOption* option, const char* separator) const {
+
+    if ( option->hasShortOption() ) {
+        text += '-';
+        text += option->getShortOption();
+    }
+
+    if ( option->hasLongOption() ) {
+
+        if ( option->hasShortOption() )
+            text += separator;
+
+        text += "--";
+        text += option->getLongOptionView();
+    }
+}
+
+Parser&
+Parser::addOption(BaseOption& option) {
+
+    checkValueFiles(option);
+
+    options.push_back(&option);
+
+    usageValid = false;
+
+    int index = options.size() - 1;
+
+    if ( option.isMandatory() )
+        mandatoryOptions.push_back(index);
+
+    // keep the indexes up to date, if the same option name
+    // is used twice the first one added is the one found
+    if ( option.hasShortOption() ) {
+
+        int& slot = shortOptions[ (unsigned char) option.getShortOption() ];
+
+        if ( slot == NOT_FOUND )
+            slot = index;
+    }
+
+    if ( option.hasLongOption() ) {
+
+        // the index keeps a view of the option own name
+        std::string_view longOption = option.getLongOptionView();
+
+        longOptions.insert(std::make_pair(longOption, index));
+        longOptionsTrie.insert(foldString(longOption.data(), longOption.size()), index);
+    }
+
+    bindEnvironment(index);
+
+    return *this;
+}
+
+Parser&
+Parser::bindEnvironment(const std::string& prefix) {
+
+    environmentPrefix = prefix;
+
+    environmentValues.clear();
+
+    for(size_t index=0; index < options.size(); ++index)
+        bindEnvironment(index);
+
+    return *this;
+}
+
+void
+Parser::bindEnvironment(int index) {
+
+    BaseOption* option = options[index];
+
+    std::string variable( option->getEnvironmentVariableView() );
+
+    // the help option is never read from the environment
+    if ( variable.empty() && option != &helpOption && option->hasLongOption() && !environmentPrefix.empty() ) {
+
+        variable = environmentPrefix;
+
+        for(size_t pos=0; pos < option->getLongOptionView().size(); ++pos) {
+
+            char c = option->getLongOptionView()[pos];
+
+            variable += ( c == '-' ) ? '_' : (char) std::toupper(c);
+        }
+    }
+
+    if ( variable.empty() )
+        return;
+
+    const char* value = environment.find(variable);
+
+    if ( value == NULL )
+        return;
+
+    EnvironmentValue binding;
+
+    binding.option   = index;
+    binding.variable = variable;
+    binding.value    = value;
+
+    environmentValues.push_back(binding);
+}
+
+bool
+Parser::loadConfig(const char* path, const std::string& section) {
+
+    std::unique_ptr<ConfigFile> file(new ConfigFile());
+
+    if ( ! file->open(path) )
+        return false;
+
+    std::string_view entrySection;
+    std::string_view key;
+    std::string_view value;
+
+    while ( file->next(entrySection, key, value) ) {
+
+        if ( ! entrySection.empty() && ! FoldedEqual()(entrySection, section) )
+            continue;
+
+        // only the options are kept, nothing is converted here
+        int index = findExactOption(key);
+
+        if ( index == NOT_FOUND || options[index] == &helpOption )
+            continue;
+
+        ConfigValue config;
+
+        config.option     = index;
+        config.value      = value.data();
+        config.file       = file.get();
+        config.lineNumber = file->getLineNumber();
+
+        configValues.push_back(config);
+    }
+
+    // keeping the order of the values of each option
+    std::stable_sort(configValues.begin(), configValues.end(), ConfigValue::byOption);
+
+    configFiles.push_back(std::move(file));
+
+    return true;
+}
+
+const BaseOption*
+Parser::lookupOption(std::string_view longOption) const {
+
+    OptionsState state;
+
+    int index = findOption(longOption, state);
+
+    return ( index != NOT_FOUND ) ? options[index] : NULL;
+}
+
+const BaseOption*
+Parser::lookupOption(char shortOption) const {
+
+    OptionsState state;
+
+    int index = findOption(shortOption, state);
+
+    return ( index != NOT_FOUND ) ? options[index] : NULL;
+}
+
+// no abbreviations, only the full long option name
+int
+Parser::findExactOption(std::string_view longOption) const {
+
+    if ( staticSchema != NULL ) {
+
+        int index = staticFindLong(staticSchema, longOption.data(), longOption.size());
+
+        if ( index >= 0 ) {
+
+            int optionIndex = getStaticOption(index);
+
+            if ( isExactName(optionIndex, longOption) )
+                return optionIndex;
+        }
+    }
+
+    LongOptionsIndex::const_iterator exact = longOptions.find( longOption );
+
+    return ( exact != longOptions.end() ) ? exact->second : NOT_FOUND;
+}
+
+int
+Parser::findOption(char shortOption, ParseState& state) const {
+
+    if ( state.statsEnabled )
+        state.stats.lookups++;
+
+    if ( staticSchema != NULL ) {
+
+        int index = staticFindShort(staticSchema, shortOption);
+
+        if ( index >= 0 )
+            return getStaticOption(index);
+    }
+
+    return shortOptions[ (unsigned char) shortOption ];
+
+}
+
+int
+Parser::findOption(std::string_view longOption, ParseState& state) const {
+
+    if ( state.statsEnabled )
+        state.stats.lookups++;
+
+    // options from the compile time schema go first, the ones
+    // added later are only searched if the schema doesn't know it
+    if ( staticSchema != NULL ) {
+
+        int index = staticFindLong(staticSchema, longOption.data(), longOption.size());
+
+        // (besides the schema ones, and the help option)
+        bool optionsAdded = ( options.size() > staticSize + 1 );
+
+        if ( index >= 0 ) {
+
+            int optionIndex = getStaticOption(index);
+
+            if ( isExactName(optionIndex, longOption) )
+                return optionIndex;
+
+            // an abbreviation, the options added later could match it too
+            if ( optionsAdded )
+                return findAddedAbbreviation(optionIndex, longOption, state);
+
+            if ( state.statsEnabled )
+                state.stats.abbreviations++;
+
+            return optionIndex;
+        }
+
+        if ( index == SchemaLookup::AMBIGUOUS ) {
+
+            // an option added later could be exactly this one
+            if ( optionsAdded ) {
+
+                LongOptionsIndex::const_iterator exact = longOptions.find( longOption );
+
+                if ( exact != longOptions.end() )
+                    return exact->second;
+            }
+
+            // the schema doesn't keep the candidates, but this is an
+            // error anyway so let's look for them the long way
+            std::vector<int> candidates;
+            std::string name(longOption);
+            int bestMatchSize = 0;
+
+            for(size_t index=0; index < options.size(); ++index) {
+
+                int matchSize = options[index]->bestMatch(name);
+
+                if ( matchSize > bestMatchSize ) {
+                    bestMatchSize = matchSize;
+                    candidates.clear();
+                }
+
+                if ( matchSize > 0 && matchSize == bestMatchSize )
+                    candidates.push_back(index);
+            }
+
+            // an option added later could match it better than the schema ones
+            if ( candidates.size() == 1 ) {
+
+                if ( state.statsEnabled )
+                    state.stats.abbreviations++;
+
+                return candidates[0];
+            }
+
+            ambiguousOption(longOption, candidates, state);
+
+            return NOT_FOUND;
+        }
+    }
+
+    // let's try first the exact match option
+    LongOptionsIndex::const_iterator exact = longOptions.find( longOption );
+
+    if ( exact != longOptions.end() )
+        return exact->second;
+
+    // now, let's search for better matching ones...
+    std::vector<int> ambiguousOptions;
+
+    int bestMatchOption = longOptionsTrie.resolve(longOption.data(), longOption.size(), ambiguousOptions);
+
+    if ( state.statsEnabled && bestMatchOption != NOT_FOUND )
+        state.stats.abbreviations++;
+
+    if ( ambiguousOptions.size() > 0 ) {
+        // if we're in an ambiguous case, it's better to report it
+        ambiguousOption(longOption, ambiguousOptions, state);
+    }
+
+    return bestMatchOption;
+
+}
+
+// an abbreviation of "schemaOption" (from the compile time schema) that
+// could also be of the options added later: the longest match wins
+int
+Parser::findAddedAbbreviation(int schemaOption, std::string_view longOption, ParseState& state) const {
+
+    LongOptionsIndex::const_iterator exact = longOptions.find( longOption );
+
+    if ( exact != longOptions.end() )
+        return exact->second;
+
+    std::vector<int> ambiguousOptions;
+
+    int addedOption = longOptionsTrie.resolve(longOption.data(), longOption.size(), ambiguousOptions);
+
+    bool addedMatches = ( addedOption != NOT_FOUND || ambiguousOptions.size() > 0 );
+
+    std::string name(longOption);
+
+    int schemaMatch = options[schemaOption]->bestMatch(name);
+    int addedMatch  = addedMatches ? options[ addedOption != NOT_FOUND ? addedOption : ambiguousOptions[0] ]->bestMatch(name) : 0;
+
+    if ( ! addedMatches || schemaMatch > addedMatch ) {
+
+        if ( state.statsEnabled )
+            state.stats.abbreviations++;
+
+        return schemaOption;
+    }
+
+    std::vector<int> candidates;
+
+    if ( schemaMatch == addedMatch )
+        candidates.push_back(schemaOption);
+
+    if ( addedOption != NOT_FOUND )
+        candidates.push_back(addedOption);
+    else
+        candidates.insert(candidates.end(), ambiguousOptions.begin(), ambiguousOptions.end());
+
+    if ( candidates.size() > 1 ) {
+        ambiguousOption(longOption, candidates, state);
+        return NOT_FOUND;
+    }
+
+    if ( state.statsEnabled )
+        state.stats.abbreviations++;
+
+    return addedOption;
+}
+
+void
+Parser::ambiguousOption(std::string_view longOption, const std::vector<int>& candidates, ParseState& state) const {
+
+    std::stringstream message;
+    message << "Option '" << longOption << "' is ambiguous: ";
+
+    for(size_t index=0; index < candidates.size(); ++index) {
+
+        if ( index > 0 )
+            message << ", ";
+
+        message << options[ candidates[index] ]->getLongOptionView();
+    }
+
+    state.fail(ParseError::AMBIGUOUS_OPTION, 0, message.str());
+
+    suggestOptions(longOption, &candidates, state);
+}
+
+// adds the closest long options (from all of them or from the
+// candidates) to the error, ie: "did you mean '--port'?"
+void
+Parser::suggestOptions(std::string_view longOption, const std::vector<int>* candidates, ParseState& state) const {
+
+    // the candidates were already chosen, any of them could be
+    Suggestions suggestions(longOption, candidates ? (size_t) EditDistance::MAX_LENGTH : Suggestions::defaultDistance(longOption));
+
+    size_t count = candidates ? candidates->size() : options.size();
+
+    for(size_t index=0; index < count; ++index)
+        suggestions.add( options[ candidates ? (*candidates)[index] : index ]->getLongOptionView() );
+
+    state.error.suggestions = suggestions.getNames();
+
+    appendSuggestions(state.error, "--");
+}
+
+// "did you mean 'a' or 'b'?" as the last line of the message
+void
+Parser::appendSuggestions(ParseError& error, const char* prefix) {
+
+    for(size_t index=0; index < error.suggestions.size(); ++index) {
+
+        if ( index == 0 )
+            error.message += "\nDid you mean '";
+        else if ( index + 1 == error.suggestions.size() )
+            error.message += " or '";
+        else
+            error.message += ", '";
+
+        error.message += prefix;
+        error.message += error.suggestions[index];
+        error.message += '\'';
+    }
+
+    if ( ! error.suggestions.empty() )
+        error.message += '?';
+}
+
+/*
+ * Commands
+ *
+ * A program can have commands (git style), each one with its own
+ * options. The options of a command are the members of a Command,
+ * added to its parser by its constructor:
+ *
+ *      class CloneCommand : public Command {
+ *
+ *          public:
+ *
+ *          CloneCommand() {
+ *              parser.addOption(depth).addOption(bare);
+ *          }
+ *
+ *          IntegerOption depth { 'd', "depth", false, 0, "history depth" };
+ *          BoolOption    bare  { 'b', "bare",  false,    "no working tree" };
+ *      };
+ *
+ *      parser.addOption(verbose)
+ *            .addCommand<CloneCommand>("clone", "clones a repository")
+ *            .addCommand<PushCommand> ("push",  "pushes the changes");
+ *
+ *      std::vector<std::string> files = parser.parse(argc, argv);
+ *
+ *      if ( CloneCommand* clone = dynamic_cast<CloneCommand*>(parser.getCommand()) )
+ *          ...
+ *
+ * Adding a command only keeps its name and its factory, the command
+ * (and its options) is built the first time it's selected, so the
+ * cost of a parse only depends on the command used. The options
+ * before the command are the program ones, the ones after it are the
+ * command ones ("prog -v clone -d 1 url"), and the other arguments
+ * are returned by parse() as usual.
+ */
+
+class Command {
+
+    public:
+
+    virtual ~Command() {}
+
+    Parser& getParser() { return parser; }
+
+    protected:
+
+    // the options of the command are added to it
+    Parser parser;
+};
+
+Parser::~Parser() {
+
+    for(size_t index=0; index < commands.size(); ++index)
+        delete commands[index].command;
+}
+
+Parser&
+Parser::addCommand(const char* name, const char* descr, CommandFactory factory) {
+
+    CommandEntry entry;
+
+    entry.name        = StringPool::shared().intern(name);
+    entry.description = StringPool::shared().intern(descr);
+    entry.factory     = factory;
+    entry.command     = NULL;
+
+    commands.push_back(entry);
+
+    usageValid = false;
+
+    return *this;
+}
+
+Command*
+Parser::getCommand() const {
+    return ( ownState.command != NOT_FOUND ) ? commands[ownState.command].command : NULL;
+}
+
+std::string
+Parser::getCommandName() const {
+    return ( ownState.command != NOT_FOUND ) ? std::string(commands[ownState.command].name) : std::string();
+}
+
+void
+Parser::reset() {
+
+    ownState.reset();
+
+    for(size_t index=0; index < commands.size(); ++index) {
+        if ( commands[index].command != NULL )
+            commands[index].command->getParser().reset();
+    }
+}
+
+// "name" is the first other argument, the arguments after it
+// are kept (unread) for the parser of the command
+bool
+Parser::selectCommand(std::string_view name, ArgumentReader& reader, ParseState& state) const {
+
+    // there are a few of them, and this is done once per parse
+    for(size_t index=0; index < commands.size(); ++index) {
+
+        if ( name != commands[index].name )
+            continue;
+
+        state.command          = index;
+        state.commandArgNumber = reader.getArgNumber();
+
+        // (the arguments are null terminated slices of argv or of the
+        // response files of the parse, the command name is its argv[0])
+        std::vector<char*>& arguments = *state.commandArguments;
+        std::string_view    argument  = name;
+
+        arguments.clear();
+
+        do {
+            arguments.push_back( const_cast<char*>(reader.terminate(argument)) );
+        } while ( reader.next(argument) );
+
+        arguments.push_back(NULL);
+
+        if ( reader.getFailedFile() != NULL )
+            return unterminatedQuote(reader, state);
+
+        return true;
+    }
+
+    std::stringstream message;
+    message << "Unknown command '" << name << "' (see arg number " << reader.getArgNumber() << ")";
+
+    state.fail(ParseError::UNKNOWN_COMMAND, reader.getArgNumber(), message.str());
+
+    Suggestions suggestions(name, Suggestions::defaultDistance(name));
+
+    for(size_t index=0; index < commands.size(); ++index)
+        suggestions.add(commands[index].name);
+
+    state.error.suggestions = suggestions.getNames();
+
+    appendSuggestions(state.error, "");
+
+    return false;
+}
+
+// builds the command selected (if it wasn't yet) and parses its
+// arguments, returns its parser (with the error, if any)
+Parser*
+Parser::parseCommand(std::vector<std::string_view>& otherArguments) {
+
+    CommandEntry& entry = commands[ownState.command];
+
+    if ( entry.command == NULL )
+        entry.command = entry.factory();
+
+    Parser& commandParser = entry.command->getParser();
+
+    commandParser.programName = programName + " " + std::string(entry.name);
+
+    commandParser.ownState.otherArguments   = &otherArguments;
+    commandParser.ownState.commandArguments = &commandParser.commandArguments;
+
+    if ( commandParser.parseArguments(commandArguments.size() - 1, &commandArguments[0], commandParser.ownState, ownState.commandArgNumber) &&
+         commandParser.ownState.command != NOT_FOUND )
+    {
+        // a command of the command
+        return commandParser.parseCommand(otherArguments);
+    }
+
+    return &commandParser;
+}
+
+/*
+ * Parse snapshots
+ *
+ * The values of a ParseResult can be written in a binary snapshot and
+ * read by other processes without parsing again, ie: a master that
+ * parses once and forks (or execs) its workers. The snapshot has no
+ * pointers (only offsets from its start), so it can be mapped anywhere:
+ *
+ *      // master
+ *      ParseResult result;
+ *
+ *      if ( parser.parse(argc, argv, result).failed() )
+ *          ...
+ *
+ *      int fd = memfd_create("options", 0);
+ *
+ *      parser.writeSnapshot(result, fd);
+ *
+ *      // worker (with the same options added to its parser)
+ *      ParseSnapshot snapshot;
+ *
+ *      if ( snapshot.map(fd, parser) ) {
+ *          int port = snapshot.get(portHandle);            // a load
+ *          std::string_view name = snapshot.get(nameHandle);
+ *          ValueSpan<int> ids = snapshot.get(idsHandle);   // no copies
+ *      }
+ *
+ * Strings are read as string_views and numeric lists as ValueSpans,
+ * both pointing into the snapshot. The options with values of other
+ * types (ie: IntervalSets) can't be written. A snapshot is only read
+ * by a parser whose options have the same names and types as the one
+ * that wrote it (see Parser::getSchemaId).
+ *
+ * The layout is a SnapshotHeader, one SnapshotEntry per option (plus
+ * one for the other arguments) and the values, each one aligned to 8
+ * bytes. It's written in the byte order of the machine.
+ */
+
+enum {
+    SNAPSHOT_MAGIC   = 0x50534f50,     // "POSP"
+    SNAPSHOT_VERSION = 1
+};
+
+struct SnapshotHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint64_t    schemaId;
+    uint64_t    size;           // of the whole snapshot
+    uint32_t    optionCount;
+    uint32_t    reserved;
+};
+
+struct SnapshotEntry {
+
+    enum {
+        FOUND   = 1,
+        STRINGS = 2             // the value is a table of SnapshotStrings
+    };
+
+    uint32_t    flags;
+    uint32_t    reserved;
+    uint64_t    offset;         // of the value, from the start of the snapshot
+    uint64_t    size;           // of the value, in bytes
+    uint64_t    count;          // of values (1 but for lists)
+};
+
+// a string of a snapshot
+struct SnapshotString {
+    uint64_t    offset;
+    uint64_t    length;         // without the null terminator
+};
+
+// builds a snapshot in a string, the values are appended
+// after the header and the entries (see Parser::writeSnapshot)
+class SnapshotWriter {
+
+    public:
+
+    SnapshotWriter(std::string& output) : blob(output) {}
+
+    // appends a value aligned to 8 bytes, returns its offset
+    uint64_t append(const void* data, size_t size) {
+
+        uint64_t offset = reserve(size);
+
+        if ( size > 0 )
+            memcpy(&blob[offset], data, size);
+
+        return offset;
+    }
+
+    // room for a value (zeroed), returns its offset
+    uint64_t reserve(size_t size) {
+
+        size_t offset = ( blob.size() + 7 ) & ~size_t(7);
+
+        blob.resize(offset + size);
+
+        return offset;
+    }
+
+    // the strings (null terminated), then the table of its offsets
+    template<typename STRING>
+    void appendStrings(SnapshotEntry& entry, const std::vector<STRING>& strings) {
+
+        std::vector<SnapshotString> table(strings.size());
+
+        for(size_t index=0; index < strings.size(); ++index) {
+
+            table[index].offset = reserve(strings[index].size() + 1);
+            table[index].length = strings[index].size();
+
+            memcpy(&blob[table[index].offset], strings[index].data(), strings[index].size());
+        }
+
+        entry.flags |= SnapshotEntry::STRINGS;
+        entry.offset = append(table.data(), table.size() * sizeof(SnapshotString));
+        entry.size   = table.size() * sizeof(SnapshotString);
+        entry.count  = table.size();
+    }
+
+    std::string& getBlob() const { return blob; }
+
+    private:
+
+    std::string& blob;
+};
+
+// how each kind of value is written, numbers as they're in memory
+// and strings null terminated. The others are not written
+template<typename T>
+bool writeSnapshotValue(SnapshotWriter& writer, SnapshotEntry& entry, const T& value) {
+
+    if constexpr ( std::is_arithmetic<T>::value && alignof(T) <= 8 ) {
+        entry.offset = writer.append(&value, sizeof(T));
+        entry.size   = sizeof(T);
+        entry.count  = 1;
+        return true;
+    }
+
+    return false;
+}
+
+inline bool writeSnapshotValue(SnapshotWriter& writer, SnapshotEntry& entry, std::string_view value) {
+
+    // the null terminator is not counted
+    entry.offset = writer.reserve(value.size() + 1);
+    entry.size   = value.size();
+    entry.count  = 1;
+
+    memcpy(&writer.getBlob()[entry.offset], value.data(), value.size());
+
+    return true;
+}
+
+inline bool writeSnapshotValue(SnapshotWriter& writer, SnapshotEntry& entry, const std::string& value) {
+    return writeSnapshotValue(writer, entry, std::string_view(value));
+}
+
+template<typename T>
+bool writeSnapshotValue(SnapshotWriter& writer, SnapshotEntry& entry, const std::vector<T>& values) {
+
+    if constexpr ( std::is_arithmetic<T>::value && alignof(T) <= 8 ) {
+        entry.offset = writer.append(values.data(), values.size() * sizeof(T));
+        entry.size   = values.size() * sizeof(T);
+        entry.count  = values.size();
+        return true;
+    }
+
+    return false;
+}
+
+inline bool writeSnapshotValue(SnapshotWriter& writer, SnapshotEntry& entry, const std::vector<std::string>& values) {
+    writer.appendStrings(entry, values);
+    return true;
+}
+
+inline bool writeSnapshotValue(SnapshotWriter& writer, SnapshotEntry& entry, const std::vector<std::string_view>& values) {
+    writer.appendStrings(entry, values);
+    return true;
+}
+
+// the strings of a snapshot (a StringListOption or the other
+// arguments), or the default value of the option
+class SnapshotStrings {
+
+    public:
+
+    SnapshotStrings() : base(NULL), table(NULL), defaults(NULL), viewDefaults(NULL), count(0) {}
+
+    SnapshotStrings(const char* data, const SnapshotEntry& entry)
+     : base(data), table(reinterpret_cast<const SnapshotString*>(data + entry.offset)),
+       defaults(NULL), viewDefaults(NULL), count(entry.count)
+    {}
+
+    SnapshotStrings(const std::vector<std::string>& values)
+     : base(NULL), table(NULL), defaults(&values), viewDefaults(NULL), count(values.size())
+    {}
+
+    SnapshotStrings(const std::vector<std::string_view>& values)
+     : base(NULL), table(NULL), defaults(NULL), viewDefaults(&values), count(values.size())
+    {}
+
+    size_t size()  const { return count; }
+    bool   empty() const { return count == 0; }
+
+    std::string_view operator[](size_t index) const {
+
+        if ( defaults != NULL )
+            return (*defaults)[index];
+
+        if ( viewDefaults != NULL )
+            return (*viewDefaults)[index];
+
+        return std::string_view(base + table[index].offset, table[index].length);
+    }
+
+    private:
+
+    const char*                          base;
+    const SnapshotString*                table;
+    const std::vector<std::string>*      defaults;
+    const std::vector<std::string_view>* viewDefaults;
+    size_t                               count;
+};
+
+// what ParseSnapshot::get() returns for each kind of value
+template<typename T>
+struct SnapshotView {
+
+    static_assert(std::is_arithmetic<T>::value && alignof(T) <= 8, "this value can't be read from a snapshot");
 
-            // let's allow the separation between key and value by '='
-            // on long options
-            std::string optionAndValueStr = argument.substr(2);
+    typedef T Type;
 
-            // initially we suppose there is no value
-            std::string optionStr = optionAndValueStr;
+    // (only the bytes written are read, a broken
+    // snapshot can't make it read out of it)
+    static Type read(const char* data, const SnapshotEntry& entry) {
+        T value = T();
+        memcpy(&value, data + entry.offset, std::min<size_t>(entry.size, sizeof(T)));
+        return value;
+    }
 
-            int separator = optionStr.find('=');
+    static Type fromDefault(const T& value) { return value; }
+};
 
-            if ( separator != std::string::npos ) {
-                optionStr     = optionAndValueStr.substr(0, separator);
-                possibleValue = optionAndValueStr.substr(separator+1);
-            }
+template<>
+struct SnapshotView<std::string> {
 
-            option = findOption( optionStr );
+    typedef std::string_view Type;
 
-        }
+    static Type read(const char* data, const SnapshotEntry& entry) {
+        return std::string_view(data + entry.offset, entry.size);
+    }
 
-        if ( option == NULL ) {
-            std::stringstream error;
-            error << "Unknown option '" << argument << "' (see arg number " << argNumber << ")";
-            usage(error.str());
-        }
+    static Type fromDefault(const std::string& value) { return value; }
+};
 
-        // let's see if this needs an argument
-        if ( option->needArgument() ) {
+template<>
+struct SnapshotView<std::string_view> {
 
-            if ( possibleValue.empty() ) {
+    typedef std::string_view Type;
 
-                // try to get the next one or fail
-                if ( argNumber+1 < argc ) {
+    static Type read(const char* data, const SnapshotEntry& entry) {
+        return std::string_view(data + entry.offset, entry.size);
+    }
 
-                    // let's move to the next argument
-                    argNumber++;
+    static Type fromDefault(std::string_view value) { return value; }
+};
 
-                    option->setValue( argv[argNumber] );
+template<typename T>
+struct SnapshotView< std::vector<T> > {
 
-                }
-                else {
-                    std::stringstream error;
-                    error << "Option '" << argument << "' needs an additional argument";
-                    usage(error.str());
-                }
+    static_assert(std::is_arithmetic<T>::value && alignof(T) <= 8, "this value can't be read from a snapshot");
 
-            }
-            else {
-                // the value we got directly from the option:
-                //   --key=value or -kvalue
-                option->setValue( possibleValue.c_str() );
-            }
+    typedef ValueSpan<T> Type;
 
-        }
-        else {
-            // set as read
-            option->markAsFound();
-        }
+    // the values are aligned to 8 bytes in the snapshot
+    static Type read(const char* data, const SnapshotEntry& entry) {
+        return ValueSpan<T>(reinterpret_cast<const T*>(data + entry.offset), entry.size / sizeof(T));
+    }
 
+    static Type fromDefault(const std::vector<T>& values) {
+        return ValueSpan<T>(values.data(), values.size());
     }
+};
 
-    // now, let's do some basic checking
+template<>
+struct SnapshotView< std::vector<std::string> > {
 
-    // was the help option requested?
-    if ( helpOption.isSet() ) {
-        usage();
+    typedef SnapshotStrings Type;
+
+    static Type read(const char* data, const SnapshotEntry& entry) {
+        return SnapshotStrings(data, entry);
     }
 
-    // let's go thru all the options to get all the
-    // ones that are mandatories and that weren't
-    // set
-   
-    std::string mandatoriesError; 
+    static Type fromDefault(const std::vector<std::string>& values) {
+        return SnapshotStrings(values);
+    }
+};
 
-    for(std::vector<BaseOption*>::iterator iter = options.begin();
-        iter != options.end();
-        ++iter
-    ) {
+template<>
+struct SnapshotView< std::vector<std::string_view> > {
 
-        BaseOption* option = *iter;
+    typedef SnapshotStrings Type;
 
-        if ( option->isMandatory() && !option->isSet() ) {
+    static Type read(const char* data, const SnapshotEntry& entry) {
+        return SnapshotStrings(data, entry);
+    }
 
-            if ( ! mandatoriesError.empty() )
-                mandatoriesError += ", ";
+    static Type fromDefault(const std::vector<std::string_view>& values) {
+        return SnapshotStrings(values);
+    }
+};
 
-            mandatoriesError += getSummaryOptionText(option);
-        }
+// reads the values of a snapshot, as a ParseResult does
+class ParseSnapshot {
+
+    public:
+
+    ParseSnapshot() : data(NULL), size(0), entries(NULL), optionCount(0), mapped(false) {}
+
+    ~ParseSnapshot() { close(); }
+
+    // reads the snapshot in "memory" (it must be aligned to 8 bytes and
+    // outlive this object), false if it's not a valid snapshot for the
+    // options of "parser"
+    bool open(const void* memory, size_t length, const Parser& parser);
+
+    // maps the snapshot written in "fd" (from its start), false if it
+    // can't be mapped (see errno) or it's not a valid snapshot
+    bool map(int fd, const Parser& parser);
+
+    void close();
 
+    bool isOpen() const { return data != NULL; }
+
+    template<typename OPTION>
+    bool isSet(const OptionHandle<OPTION>& handle) const {
+
+        size_t index = handle.getIndex();
+
+        return index < optionCount && ( entries[index].flags & SnapshotEntry::FOUND );
     }
 
-    if ( ! mandatoriesError.empty() ) {
-        usage("The following arguments are mandatory: " + mandatoriesError);
+    // the value written, or the option default value (it throws
+    // std::invalid_argument for a handle that is not valid)
+    template<typename OPTION>
+    typename SnapshotView<typename OPTION::ValueType>::Type get(const OptionHandle<OPTION>& handle) const {
+
+        typedef SnapshotView<typename OPTION::ValueType> View;
+
+        if ( ! handle.isValid() )
+            throw std::invalid_argument("invalid option handle");
+
+        if ( ! isSet(handle) )
+            return View::fromDefault( handle.getOption()->getDefaultValue() );
+
+        return View::read( data, entries[handle.getIndex()] );
     }
 
-    return otherArguments;
-}
+    SnapshotStrings getOtherArguments() const {
+        return isOpen() ? SnapshotStrings(data, entries[optionCount]) : SnapshotStrings();
+    }
+
+    private:
 
+    ParseSnapshot(const ParseSnapshot&);
+    ParseSnapshot& operator=(const ParseSnapshot&);
 
-void
-Parser::usage(const char* text) {
+    const char*          data;
+    size_t               size;
+    const SnapshotEntry* entries;
+    size_t               optionCount;
+    bool                 mapped;
 
-    if ( strcmp(text, "") != 0 ) {
-        std::cerr << text << std::endl;
+    bool isInside(uint64_t offset, uint64_t length) const {
+        return offset <= size && length <= size - offset;
     }
+};
 
-    // add the options
-    std::cerr << "Usage: ";
-    std::cerr << programName << " ";
+bool
+ParseSnapshot::open(const void* memory, size_t length, const Parser& parser) {
 
-    std::stringstream optionsSummary;
-    std::stringstream fullDescription;
+    close();
 
-    int maxWidth = 30;
+    const char* snapshot = static_cast<const char*>(memory);
 
+    if ( snapshot == NULL || ( reinterpret_cast<uintptr_t>(snapshot) & 7 ) != 0 || length < sizeof(SnapshotHeader) )
+        return false;
 
-    for(std::vector<BaseOption*>::iterator iter = options.begin();
-        iter != options.end();
-        ++iter
-    ) {
+    const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(snapshot);
 
-        BaseOption* option = *iter;
+    if ( header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+         header->schemaId != parser.getSchemaId() || header->size > length )
+        return false;
 
-        // this is the syntax:
-        //   [ ] => optional
-        //   short|long
-        std::string summaryOptionBase = getSummaryOptionText(option);
-        std::string fullOptionBase    = getFullOptionText(option);
+    // everything is checked here, so reading the values doesn't need to
+    data        = snapshot;
+    size        = header->size;
+    optionCount = header->optionCount;
+    entries     = reinterpret_cast<const SnapshotEntry*>(snapshot + sizeof(SnapshotHeader));
 
-        if ( option->needArgument() ) {
-            summaryOptionBase += " value";
-            fullOptionBase    += " value";
-        }
+    bool valid = isInside(sizeof(SnapshotHeader), (optionCount + 1) * sizeof(SnapshotEntry));
 
-        // summary 
-        if ( ! option->isMandatory() ) {
-            optionsSummary << "[" << summaryOptionBase << "]";
-        }
-        else {
-            optionsSummary << summaryOptionBase;
+    for(size_t index=0; valid && index <= optionCount; ++index) {
+
+        const SnapshotEntry& entry = entries[index];
+
+        if ( ! ( entry.flags & SnapshotEntry::FOUND ) && index < optionCount )
+            continue;
+
+        valid = ( entry.offset & 7 ) == 0 && isInside(entry.offset, entry.size);
+
+        if ( valid && ( entry.flags & SnapshotEntry::STRINGS ) ) {
+
+            const SnapshotString* table = reinterpret_cast<const SnapshotString*>(snapshot + entry.offset);
+
+            valid = entry.size % sizeof(SnapshotString) == 0 && entry.count == entry.size / sizeof(SnapshotString);
+
+            for(size_t string=0; valid && string < entry.count; ++string)
+                valid = isInside(table[string].offset, table[string].length);
         }
+    }
 
-        optionsSummary << " ";
+    if ( ! valid )
+        close();
 
-        // full description
-        fullDescription << " " << std::setw(maxWidth) << std::left << fullOptionBase << "\t\t" << option->getDescription() << std::endl;
+    return valid;
+}
+
+bool
+ParseSnapshot::map(int fd, const Parser& parser) {
+
+    close();
+
+    struct stat info;
 
+    if ( fstat(fd, &info) != 0 )
+        return false;
+
+    if ( info.st_size < (off_t) sizeof(SnapshotHeader) ) {
+        errno = EINVAL;
+        return false;
     }
 
-    std::cerr << optionsSummary.str() << std::endl;
-    std::cerr << "Options:" << std::endl;
-    std::cerr << fullDescription.str();
+    void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
 
-    // end
-    exit(1);
+    if ( mapping == MAP_FAILED )
+        return false;
 
-} 
+    if ( ! open(mapping, info.st_size, parser) ) {
+        munmap(mapping, info.st_size);
+        errno = EINVAL;
+        return false;
+    }
 
-std::string
-Parser::getOptionText(BaseOption* option, const char* separator) {
+    // the whole mapping, not only the snapshot, is unmapped
+    size   = info.st_size;
+    mapped = true;
 
-    std::string optionBase;
+    return true;
+}
 
-    if ( option->hasShortOption() ) {
-        optionBase += "-";
-        optionBase += option->getShortOption();
+void
+ParseSnapshot::close() {
+
+    if ( mapped )
+        munmap(const_cast<char*>(data), size);
+
+    data        = NULL;
+    size        = 0;
+    entries     = NULL;
+    optionCount = 0;
+    mapped      = false;
+}
+
+bool
+Parser::writeSnapshot(const ParseResult& result, std::string& blob) const {
+
+    SnapshotWriter writer(blob);
+
+    size_t count = options.size();
+
+    blob.clear();
+    writer.reserve(sizeof(SnapshotHeader) + (count + 1) * sizeof(SnapshotEntry));
+
+    for(size_t index=0; index < count; ++index) {
+
+        SnapshotEntry entry = SnapshotEntry();
+
+        const OptionValue* value = ( index < result.values.size() ) ? result.values[index].get() : NULL;
+
+        if ( value != NULL && value->found ) {
+
+            entry.flags = SnapshotEntry::FOUND;
+
+            if ( ! value->writeSnapshot(writer, entry) )
+                return false;
+        }
+
+        // the blob could have grown, the entry is copied at the end
+        memcpy(&blob[sizeof(SnapshotHeader) + index * sizeof(SnapshotEntry)], &entry, sizeof(entry));
     }
 
-    if ( option->hasLongOption() ) {
+    SnapshotEntry others = SnapshotEntry();
 
-        if ( option->hasShortOption() )
-            optionBase += separator;
+    writer.appendStrings(others, result.others);
+
+    memcpy(&blob[sizeof(SnapshotHeader) + count * sizeof(SnapshotEntry)], &others, sizeof(others));
+
+    SnapshotHeader header = SnapshotHeader();
+
+    header.magic       = SNAPSHOT_MAGIC;
+    header.version     = SNAPSHOT_VERSION;
+    header.schemaId    = getSchemaId();
+    header.size        = blob.size();
+    header.optionCount = count;
+
+    memcpy(&blob[0], &header, sizeof(header));
+
+    return true;
+}
+
+bool
+Parser::writeSnapshot(const ParseResult& result, int fd) const {
+
+    std::string blob;
 
-        optionBase += "--" + option->getLongOption();
+    if ( ! writeSnapshot(result, blob) ) {
+        errno = EINVAL;
+        return false;
     }
 
-    return optionBase;
+    return writeFully(fd, blob.data(), blob.size());
 }
 
-BaseOption*
-Parser::findOption(char shortOption) {
+uint64_t
+Parser::getSchemaId() const {
+
+    // FNV-1a of the names and the types of the options
+    uint64_t id = 0xcbf29ce484222325ULL;
+
+    auto add = [&id](const char* text, size_t length) {
+        for(size_t index=0; index < length; ++index) {
+            id ^= (unsigned char) text[index];
+            id *= 0x100000001b3ULL;
+        }
+    };
 
-    // iterate over the array and search for the short option
-    for(int index=0; index < options.size(); ++index) {
+    for(size_t index=0; index < options.size(); ++index) {
 
-        BaseOption* option = options.at(index);
+        const BaseOption* option = options[index];
+        const char*       type   = typeid(*option).name();
 
-        if ( option->matches( shortOption ) )
-            return option;
+        char flags[2] = { option->getShortOption(), option->needArgument() ? '1' : '0' };
 
+        add(flags, sizeof(flags));
+        add(option->getLongOptionView().data(), option->getLongOptionView().size() + 1);
+        add(type, strlen(type) + 1);
     }
 
-    return NULL;
+    return id;
+}
+
+/*
+ * Option structs
+ *
+ * The options can also be the fields of a plain struct, so reading them
+ * is just reading a field (no virtual calls, no copies). Each field is
+ * bound to its names with add(), the struct initializers are the
+ * default values:
+ *
+ *      struct ServerOptions {
+ *          bool                debug = false;
+ *          int                 port  = 23;
+ *          std::string         username;
+ *          std::vector<int>    ids;
+ *      };
+ *
+ *      StructParser<ServerOptions> parser;
+ *
+ *      parser.add<&ServerOptions::debug>   ('d', "debug",    false, "enables the debug mode")
+ *            .add<&ServerOptions::port>    ('p', "port",     false, "server port")
+ *            .add<&ServerOptions::username>('u', "username", true,  "set the username")
+ *            .add<&ServerOptions::ids>     ('i', "id",       false, "ids of interest");
+ *
+ *      ServerOptions options;
+ *
+ *      if ( parser.parse(argc, argv, options).failed() )
+ *          ...
+ *
+ *      while ( ... )
+ *          if ( options.debug )      // a plain load
+ *              ...
+ *
+ * The fields can be bool (flags), the types with a Converter, vectors
+ * of them (lists) and IntervalSets. Each value is stored by a function
+ * generated for its field, straight into the struct. A list (or an
+ * IntervalSet) found in the command line replaces its initial values,
+ * it doesn't add to them. Everything else (names, abbreviations, usage,
+ * response files, environment and config files) is done by a Parser,
+ * its settings are forwarded by the StructParser (bindEnvironment(),
+ * loadConfig()...). The parser itself is not exposed: an option added
+ * to it wouldn't have a field.
+ */
+
+// what a Parser knows about a field (its names), the values
+// are not stored here but in the struct (see StructParser)
+class StructFieldOption : public BaseOption {
+
+    public:
+
+    StructFieldOption(char sOption, const char* lOption, bool mandat, bool fArgument, const char* descr)
+     : BaseOption(sOption, lOption, mandat, fArgument, descr)
+    {}
+
+    virtual void setValue(const char* readValue) {}
+};
+
+template<typename TYPE>
+inline ConversionResult storeField(TYPE& field, const char* text) {
+    return Converter<TYPE>::convert( text, strlen(text), field );
+}
+
+template<typename TYPE>
+inline ConversionResult storeField(std::vector<TYPE>& field, const char* text) {
+    return appendListValue( field, text, strlen(text) );
+}
+
+template<typename TYPE>
+inline ConversionResult storeField(IntervalSet<TYPE>& field, const char* text) {
+    return field.add( text, strlen(text) );
+}
+
+// the fields that take several values forget the
+// initial ones when the first value is stored
+template<typename TYPE>
+inline void clearField(TYPE& field) {}
+
+template<typename TYPE>
+inline void clearField(std::vector<TYPE>& field) {
+    field.clear();
+}
 
+template<typename TYPE>
+inline void clearField(IntervalSet<TYPE>& field) {
+    field.clear();
 }
 
-BaseOption*
-Parser::findOption(std::string longOption) {
+template<typename STRUCT>
+class StructParser {
+
+    public:
+
+    // the help option has no field
+    StructParser() : fields(1, Field()), state(*this) {}
+
+    template<auto MEMBER>
+    StructParser& add(char shortOption, const char* longOption, bool mandatory, const char* descr = "");
+
+    // parses into "object", only the fields found are changed.
+    // The other arguments are kept until the next parse
+    const ParseError& parse(int argc, char** argv, STRUCT& object);
 
-    // iterate over the array and search for the exact match option
-    for(int index=0; index < options.size(); ++index) {
-        BaseOption* option = options.at(index);
-        if ( option->matches( longOption ) )
-            return option;
+    const std::vector<std::string_view>& getOtherArguments() const { return state.others; }
+
+    // the settings of the parser behind (see Parser)
+    StructParser& bindEnvironment(const std::string& prefix) {
+        parser.bindEnvironment(prefix);
+        return *this;
     }
 
-    // now, let's search for better matching ones...
-    int bestMatchSize   = 0;
-    BaseOption* bestMatchOption = NULL;
-    std::vector<std::string> ambiguousOptions;
+    bool loadConfig(const char* path, const std::string& section = "") {
+        return parser.loadConfig(path, section);
+    }
+
+    StructParser& allowResponseFiles(bool allow = true) {
+        parser.allowResponseFiles(allow);
+        return *this;
+    }
+
+    StructParser& allowCompletion(bool allow = true) {
+        parser.allowCompletion(allow);
+        return *this;
+    }
+
+    void usage(const char* text = "") { parser.usage(text); }
+
+    std::string getUsage() { return parser.getUsage(); }
+
+    private:
+
+    template<typename MEMBER_POINTER>
+    struct MemberType;
+
+    template<typename FIELD>
+    struct MemberType<FIELD STRUCT::*> {
+        typedef FIELD Type;
+    };
+
+    typedef ConversionResult (*StoreFunction)(STRUCT&, const char*);
+    typedef void             (*FlagFunction)(STRUCT&);
+
+    // the functions of each option, by its index in the parser
+    // (the first value found is stored with "first")
+    struct Field {
+        StoreFunction store;
+        StoreFunction first;
+        FlagFunction  flag;
+    };
+
+    template<auto MEMBER>
+    static ConversionResult storeMember(STRUCT& object, const char* text) {
+        return storeField( object.*MEMBER, text );
+    }
+
+    template<auto MEMBER>
+    static ConversionResult storeFirstMember(STRUCT& object, const char* text) {
+        clearField( object.*MEMBER );
+        return storeField( object.*MEMBER, text );
+    }
+
+    template<auto MEMBER>
+    static void flagMember(STRUCT& object) {
+        object.*MEMBER = true;
+    }
 
-    for(int index=0; index < options.size(); ++index) {
-        BaseOption* option = options.at(index);
+    // the values go to the struct, only the
+    // found flags are kept here
+    class StructState : public ParseState {
 
-        int matchSize = option->bestMatch(longOption);
+        public:
 
-        // we have a new winner
-        if ( matchSize > bestMatchSize ) {
-            bestMatchSize   = matchSize;
-            bestMatchOption = option;
+        StructState(const StructParser& owner) : parser(owner), object(NULL) {}
 
-            // clear the list
-            ambiguousOptions.clear();
+        virtual void reset() {
+            others.clear();
+            responseFiles.clear();
+            error = ParseError();
         }
-        else if (bestMatchSize>0 && matchSize==bestMatchSize ) {
-            // this is conflicting with other option
-            ambiguousOptions.push_back(option->getLongOption());
+
+        const StructParser&            parser;
+        STRUCT*                        object;
+        std::vector<char>              found;
+        std::vector<std::string_view>  others;
+
+        protected:
+
+        virtual void prepare(size_t optionCount) {
+            found.assign(optionCount, 0);
+            otherArguments = &others;
         }
 
-    }
+        virtual bool wasFound(int index, BaseOption* option) {
+            return found[index] != 0;
+        }
 
-    if ( ambiguousOptions.size() > 0 ) {
-        // if we're in an ambiguous case, it's better to report it
-        std::stringstream error;
-        error << "Option '" << longOption << "' is ambiguous: ";
+        virtual void setFound(int index, BaseOption* option) {
+
+            FlagFunction flag = parser.fields[index].flag;
 
-        error << bestMatchOption->getLongOption();
+            if ( flag != NULL )
+                flag(*object);
+
+            found[index] = 1;
+        }
+
+        virtual ConversionResult setValue(int index, BaseOption* option, const char* value) {
+
+            const Field& field = parser.fields[index];
+
+            ConversionResult result = found[index] ? field.store(*object, value) : field.first(*object, value);
+
+            if ( result.ok() )
+                found[index] = 1;
+
+            return result;
+        }
 
-        for(int index=0; index < ambiguousOptions.size(); ++index) {
-            error << ", " << ambiguousOptions[index];
+        virtual size_t getValueBytes(int index, BaseOption* option) {
+            return 0;
         }
+    };
 
-        usage(error.str());
+    Parser parser;
+
+    std::vector< std::unique_ptr<StructFieldOption> > options;
+    std::vector<Field> fields;
+
+    StructState state;
+};
+
+template<typename STRUCT>
+template<auto MEMBER>
+StructParser<STRUCT>&
+StructParser<STRUCT>::add(char shortOption, const char* longOption, bool mandatory, const char* descr) {
+
+    typedef typename MemberType<decltype(MEMBER)>::Type FieldType;
+
+    options.push_back( std::unique_ptr<StructFieldOption>(
+        new StructFieldOption(shortOption, longOption, mandatory, needsArgument<FieldType>(), descr)) );
+
+    parser.addOption(*options.back());
+
+    Field field;
+
+    if constexpr ( std::is_same<FieldType, bool>::value ) {
+        field.store = NULL;
+        field.first = NULL;
+        field.flag  = &flagMember<MEMBER>;
+    }
+    else {
+        field.store = &storeMember<MEMBER>;
+        field.first = &storeFirstMember<MEMBER>;
+        field.flag  = NULL;
     }
 
+    fields.push_back(field);
 
+    return *this;
+}
 
-    return bestMatchOption;
+template<typename STRUCT>
+const ParseError&
+StructParser<STRUCT>::parse(int argc, char** argv, STRUCT& object) {
+
+    if ( parser.completionAllowed )
+        parser.handleCompletion(argc, argv);
+
+    state.reset();
+    state.object = &object;
+
+    // for the usage
+    if ( argc >= 1 && parser.programName != argv[0] )
+        parser.programName = argv[0];
+
+    parser.parseArguments(argc, argv, state);
 
+    return state.getError();
 }
 
 
@@ -0,0 +1,381 @@
+// g++ -std=c++17 -O2 benchmark.cc -I. -o benchmark   (or "make bench")
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <memory>
+#include <chrono>
+
+#include <getopt.h>
+
+#include <Parser.h>
+
+
+using namespace std;
+
+/*
+ * Parse throughput benchmark
+ *
+ * Measures Parser::parse() (and so the option lookups) for several
+ * schema sizes and argv sizes, and the same work done by getopt_long
+ * as a baseline. Workloads:
+ *
+ *      exact       : "--optN-name" flags, exact long option lookups
+ *      abbrev      : "--optN-na" flags, every one is an abbreviation
+ *      short       : "-a", "-b", ... flags
+ *      value       : "--optN-name=value" string options
+ *      list        : "--values N" repeated on an IntegerListOption
+ *      positional  : no options at all, only other arguments
+ *
+ * And the option lookups alone (Parser::lookupOption, the same lookup
+ * parse() does) for each schema size, with full and abbreviated names.
+ *
+ * Times are the best of a few runs, per parse and per argument (or per
+ * lookup).
+ */
+
+typedef chrono::steady_clock Clock;
+
+struct Workload {
+    const char* name;
+    bool        hasValue;      // the options are StringOptions
+    bool        isList;
+};
+
+static const Workload workloads[] = {
+    { "exact",      false, false },
+    { "abbrev",     false, false },
+    { "short",      false, false },
+    { "value",      true,  false },
+    { "list",       false, true  },
+    { "positional", false, false },
+};
+
+static string optionName(int index) {
+    stringstream name;
+    name << "opt" << index << "-name";
+    return name.str();
+}
+
+static char shortName(int index) {
+    static const char letters[] = "abcdefgijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    return letters[ index % (sizeof(letters) - 1) ];
+}
+
+// the arguments of a workload (as strings, argv is built from them)
+static vector<string> buildArguments(const Workload& workload, int optionCount, int argCount) {
+
+    vector<string> arguments;
+    arguments.push_back("benchmark");
+
+    string name = workload.name;
+
+    for(int index=0; (int) arguments.size() <= argCount; ++index) {
+
+        int option = (int) ( ((long long) index * 7919) % optionCount );
+
+        if ( name == "exact" )
+            arguments.push_back("--" + optionName(option));
+        else if ( name == "abbrev" )
+            arguments.push_back("--" + optionName(option).substr(0, optionName(option).size() - 2));
+        else if ( name == "short" )
+            arguments.push_back(string("-") + shortName(option));
+        else if ( name == "value" )
+            arguments.push_back("--" + optionName(option) + "=value");
+        else if ( name == "list" ) {
+            stringstream value;
+            value << index;
+            arguments.push_back("--values");
+            arguments.push_back(value.str());
+        }
+        else
+            arguments.push_back("file");
+    }
+
+    arguments.resize(argCount + 1);
+
+    return arguments;
+}
+
+static vector<char*> buildArgv(vector<string>& arguments) {
+
+    vector<char*> argv;
+
+    for(size_t index=0; index < arguments.size(); ++index)
+        argv.push_back(&arguments[index][0]);
+
+    argv.push_back(NULL);
+
+    return argv;
+}
+
+// one parser and all its options
+struct Schema {
+
+    Schema(const Workload& workload, int optionCount)
+     : values(BaseOption::NO_OPTION, "values", false, "list of values")
+    {
+        for(int index=0; index < optionCount; ++index) {
+
+            string name = optionName(index);
+            char   shortOption = ( index < 51 ) ? shortName(index) : BaseOption::NO_OPTION;
+
+            if ( workload.hasValue )
+                options.push_back(unique_ptr<BaseOption>(new StringOption(shortOption, name.c_str(), false)));
+            else
+                options.push_back(unique_ptr<BaseOption>(new BoolOption(shortOption, name.c_str(), false)));
+
+            parser.addOption(*options.back());
+        }
+
+        parser.addOption(values);
+    }
+
+    vector< unique_ptr<BaseOption> > options;
+    IntegerListOption values;
+    Parser parser;
+};
+
+static double elapsed(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double runParser(const Workload& workload, int optionCount, vector<string>& arguments, int runs, double& setup) {
+
+    double best = 0;
+
+    // parse() only reads argv, the same one is fine for all the runs
+    vector<char*> argv = buildArgv(arguments);
+
+    for(int run=0; run < runs; ++run) {
+
+        Clock::time_point start = Clock::now();
+
+        Schema schema(workload, optionCount);
+
+        double setupTime = elapsed(start);
+
+        start = Clock::now();
+
+        schema.parser.parseViews(argv.size() - 1, &argv[0]);
+
+        double time = elapsed(start);
+
+        if ( run == 0 || time < best ) {
+            best  = time;
+            setup = setupTime;
+        }
+    }
+
+    return best;
+}
+
+static double runGetopt(const Workload& workload, int optionCount, vector<string>& arguments, int runs) {
+
+    vector<string> names;
+    vector<struct option> longOptions;
+    string shortOptions = "-";  // keep the other arguments in order
+
+    for(int index=0; index < optionCount; ++index)
+        names.push_back(optionName(index));
+
+    for(int index=0; index < optionCount; ++index) {
+
+        struct option entry = { names[index].c_str(), workload.hasValue ? required_argument : no_argument, NULL, 256 + index };
+        longOptions.push_back(entry);
+
+        if ( index < 51 )
+            shortOptions += shortName(index);
+    }
+
+    // (an unused code, long options use 256 and up)
+    struct option values = { "values", required_argument, NULL, 200 };
+    struct option last   = { NULL, 0, NULL, 0 };
+
+    longOptions.push_back(values);
+    longOptions.push_back(last);
+
+    double best = 0;
+
+    for(int run=0; run < runs; ++run) {
+
+        // getopt_long permutes argv, each run needs a fresh copy
+        vector<string> copy = arguments;
+        vector<char*>  argv = buildArgv(copy);
+
+        Clock::time_point start = Clock::now();
+
+        // getopt doesn't store anything, let's do the
+        // cheapest equivalent work with the results
+        vector<const char*> others;
+        vector<int>         listValues;
+        size_t              found = 0;
+
+        optind = 0;
+        opterr = 0;
+
+        int code;
+
+        while ( (code = getopt_long(argv.size() - 1, &argv[0], shortOptions.c_str(), &longOptions[0], NULL)) != -1 ) {
+
+            if ( code == 1 )
+                others.push_back(optarg);
+            else if ( code == 200 )
+                listValues.push_back(atoi(optarg));
+            else
+                ++found;
+        }
+
+        double time = elapsed(start);
+
+        if ( run == 0 || time < best )
+            best = time;
+    }
+
+    return best;
+}
+
+// the time of each lookup of the option names (the full ones or
+// abbreviated), all of them must be found ("missed" counts the rest)
+static double runLookups(int optionCount, bool abbreviated, int lookups, int runs, size_t& missed) {
+
+    Schema schema(workloads[0], optionCount);
+
+    vector<string> names;
+
+    for(int index=0; index < optionCount; ++index) {
+
+        string name = optionName(index);
+
+        names.push_back( abbreviated ? name.substr(0, name.size() - 2) : name );
+    }
+
+    double best = 0;
+
+    for(int run=0; run < runs; ++run) {
+
+        Clock::time_point start = Clock::now();
+
+        for(int lookup=0; lookup < lookups; ++lookup) {
+            if ( schema.parser.lookupOption(names[lookup % optionCount]) == NULL )
+                ++missed;
+        }
+
+        double time = elapsed(start);
+
+        if ( run == 0 || time < best )
+            best = time;
+    }
+
+    return best / lookups;
+}
+
+int main(int argc, char** argv) {
+
+    IntegerOption maxOptions ('o', "max-options", false, 10000,   "biggest schema to measure (10 to 10000 options)");
+    IntegerOption maxArgs    ('a', "max-args",    false, 1000000, "biggest argv to measure (10 to 1000000 arguments)");
+    StringOption  onlyOne    ('w', "workload",    false,          "only this workload: exact, abbrev, short, value, list, positional or lookup");
+    IntegerOption runs       ('r', "runs",        false, 3,       "runs of each case (the best one is reported)");
+    BoolOption    noGetopt   ('g', "no-getopt",   false,          "don't measure getopt_long");
+    IntegerOption maxGetopt  ('m', "max-getopt",  false, 100000000, "skip getopt_long when options * args is bigger than this");
+
+    Parser parser;
+
+    parser.addOption(maxOptions)
+          .addOption(maxArgs)
+          .addOption(onlyOne)
+          .addOption(runs)
+          .addOption(noGetopt)
+          .addOption(maxGetopt);
+
+    parser.parse(argc, argv);
+
+    cout << left
+         << setw(11) << "workload"
+         << right
+         << setw(8)  << "options"
+         << setw(10) << "args"
+         << setw(12) << "setup ms"
+         << setw(12) << "parse ms"
+         << setw(10) << "ns/arg"
+         << setw(12) << "getopt ms"
+         << setw(10) << "ns/arg"
+         << endl;
+
+    for(size_t index=0; index < sizeof(workloads) / sizeof(workloads[0]); ++index) {
+
+        const Workload& workload = workloads[index];
+
+        if ( onlyOne.isSet() && onlyOne.getValue() != workload.name )
+            continue;
+
+        for(int optionCount=10; optionCount <= maxOptions.getValue(); optionCount *= 10) {
+            for(int argCount=10; argCount <= maxArgs.getValue(); argCount *= 10) {
+
+                vector<string> arguments = buildArguments(workload, optionCount, argCount);
+
+                double setup = 0;
+                double parse = runParser(workload, optionCount, arguments, runs.getValue(), setup);
+
+                cout << left
+                     << setw(11) << workload.name
+                     << right << fixed
+                     << setw(8)  << optionCount
+                     << setw(10) << argCount
+                     << setprecision(3)
+                     << setw(12) << setup * 1e3
+                     << setw(12) << parse * 1e3
+                     << setprecision(1)
+                     << setw(10) << parse * 1e9 / argCount;
+
+                if ( !noGetopt.isSet() && (double) optionCount * argCount <= maxGetopt.getValue() ) {
+
+                    double getopt = runGetopt(workload, optionCount, arguments, runs.getValue());
+
+                    cout << setprecision(3)
+                         << setw(12) << getopt * 1e3
+                         << setprecision(1)
+                         << setw(10) << getopt * 1e9 / argCount;
+                }
+                else {
+                    cout << setw(12) << "-" << setw(10) << "-";
+                }
+
+                cout << endl;
+            }
+        }
+    }
+
+    if ( onlyOne.isSet() && onlyOne.getValue() != "lookup" )
+        return 0;
+
+    cout << endl
+         << left
+         << setw(11) << "lookup"
+         << right
+         << setw(8)  << "options"
+         << setw(12) << "exact ns"
+         << setw(12) << "abbrev ns"
+         << endl;
+
+    size_t missed = 0;
+
+    for(int optionCount=10; optionCount <= maxOptions.getValue(); optionCount *= 10) {
+
+        double exact  = runLookups(optionCount, false, 1000000, runs.getValue(), missed);
+        double abbrev = runLookups(optionCount, true,  1000000, runs.getValue(), missed);
+
+        cout << left
+             << setw(11) << "lookup"
+             << right << fixed
+             << setw(8)  << optionCount
+             << setprecision(1)
+             << setw(12) << exact  * 1e9
+             << setw(12) << abbrev * 1e9
+             << endl;
+    }
+
+    if ( missed > 0 )
+        cerr << missed << " lookups didn't find their option" << endl;
+
+}
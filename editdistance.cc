@@ -0,0 +1,112 @@
+// g++ -std=c++17 -O2 editdistance.cc -I. -o editdistance   (or "make check")
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+
+#include <Parser.h>
+
+
+using namespace std;
+
+/*
+ * Edit distance check
+ *
+ * Compares EditDistance (Myers' bit-parallel algorithm, the one used
+ * by the suggestions) with the classic dynamic programming matrix, on
+ * random pairs of names: every pattern length up to MAX_LENGTH, both
+ * cases of the letters (they must be the same char) and random limits
+ * (below the limit the distance must be exact, above it only bigger
+ * than the limit). Exits with 1 if any pair differs.
+ */
+
+// the distance of the whole matrix, ignoring the case
+static size_t reference(const string& from, const string& to) {
+
+    vector<size_t> previous(to.size() + 1);
+    vector<size_t> current(to.size() + 1);
+
+    for(size_t column=0; column <= to.size(); ++column)
+        previous[column] = column;
+
+    for(size_t row=1; row <= from.size(); ++row) {
+
+        current[0] = row;
+
+        for(size_t column=1; column <= to.size(); ++column) {
+
+            size_t replace = previous[column - 1] + ( foldChar(from[row - 1]) != foldChar(to[column - 1]) );
+
+            current[column] = min( replace, min(previous[column], current[column - 1]) + 1 );
+        }
+
+        previous.swap(current);
+    }
+
+    return previous[to.size()];
+}
+
+// a few chars only, so there are many matches (and both cases)
+static string randomName(mt19937& random, size_t length) {
+
+    static const char chars[] = "abcABC-_9";
+
+    string name;
+
+    for(size_t index=0; index < length; ++index)
+        name += chars[ random() % (sizeof(chars) - 1) ];
+
+    return name;
+}
+
+int main(int argc, char** argv) {
+
+    IntegerOption pairs ('p', "pairs", false, 200000, "random pairs to compare");
+    IntegerOption seed  ('s', "seed",  false, 1,      "seed of the random names");
+
+    Parser parser;
+
+    parser.addOption(pairs)
+          .addOption(seed);
+
+    parser.parse(argc, argv);
+
+    mt19937 random( seed.getValue() );
+
+    int failures = 0;
+
+    for(int pair=0; pair < pairs.getValue(); ++pair) {
+
+        // every pattern length, and texts a bit longer than them
+        string from = randomName( random, pair % (EditDistance::MAX_LENGTH + 1) );
+        string to   = randomName( random, random() % (EditDistance::MAX_LENGTH + 16) );
+
+        EditDistance distance(from);
+
+        size_t expected = reference(from, to);
+        size_t limit    = random() % 16;
+        size_t full     = distance.to(to);
+        size_t limited  = distance.to(to, limit);
+
+        bool ok = ( full == expected ) &&
+                  ( expected <= limit ? limited == expected : limited > limit );
+
+        if ( ok )
+            continue;
+
+        if ( ++failures <= 10 ) {
+            cerr << "'" << from << "' -> '" << to << "': " << full
+                 << " (limit " << limit << ": " << limited << "), expected " << expected << endl;
+        }
+    }
+
+    if ( failures > 0 ) {
+        cerr << failures << " of " << pairs.getValue() << " pairs differ" << endl;
+        return 1;
+    }
+
+    cout << pairs.getValue() << " pairs, the same distances" << endl;
+
+    return 0;
+}
@@ -60,11 +60,11 @@ int main(int argc, char** argv) {
     }
 
     if ( book.isSet() ) {
-        std::list<std::string> values = book.getValue();
+        const std::vector<std::string>& values = book.getValues();
 
         cout << "book was set with " << values.size() << " entries: ";
 
-        for(std::list<string>::iterator entry = values.begin();
+        for(std::vector<string>::const_iterator entry = values.begin();
             entry != values.end();
             ++entry
         ) {
@@ -79,9 +79,9 @@ int main(int argc, char** argv) {
     }
 
     //if ( portRange.isSet() ) {
-        std::list<int> list = portRange.getValue();
+        ValueSpan<int> list = portRange.getSpan();
         if ( list.size() > 0 ) {
-            cout << "Range seted from '" << list.front() << "' to '" << list.back() << "'." << endl;
+            cout << "Range seted from '" << portRange.getBegin() << "' to '" << portRange.getEnd() << "'." << endl;
         } else {
             cout << "is null" << std::endl;
         }